@@ -0,0 +1,191 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace bench
+{
+/// Output format of the results: aligned text for humans, CSV or JSON (one object per line) for scripts.
+enum class Format
+{
+    Text,
+    Csv,
+    Json
+};
+
+/// The output format, shared by all reports of a benchmark.
+inline Format &format()
+{
+    static Format format = Format::Text;
+    return format;
+}
+
+/// Settings shared by all benchmarks, read from the command line: [--csv|--json] [max threads] [milliseconds per run].
+struct Settings
+{
+    unsigned maxThreads;
+    std::chrono::milliseconds duration;
+};
+
+inline Settings parseSettings(int argc, char **argv)
+{
+    Settings settings{std::max(2u, std::thread::hardware_concurrency()), std::chrono::milliseconds(300)};
+    int position = 0;
+    for (int index = 1; index < argc; ++index)
+    {
+        if (std::strcmp(argv[index], "--csv") == 0)
+        {
+            format() = Format::Csv;
+        }
+        else if (std::strcmp(argv[index], "--json") == 0)
+        {
+            format() = Format::Json;
+        }
+        else if (position++ == 0)
+        {
+            settings.maxThreads = static_cast<unsigned>(std::max(1l, std::strtol(argv[index], nullptr, 10)));
+        }
+        else
+        {
+            settings.duration = std::chrono::milliseconds(std::max(1l, std::strtol(argv[index], nullptr, 10)));
+        }
+    }
+    return settings;
+}
+
+/// Thread counts to benchmark: powers of two up to, and including, maxThreads.
+inline std::vector<unsigned> threadCounts(unsigned maxThreads)
+{
+    std::vector<unsigned> counts;
+    for (unsigned count = 1; count < maxThreads; count *= 2)
+    {
+        counts.push_back(count);
+    }
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+/// Cheap xorshift generator, so that drawing random numbers does not dominate the measurements.
+class Random
+{
+  public:
+    explicit Random(std::uint64_t seed) : m_state(seed * 0x9E3779B97F4A7C15ull + 1)
+    {
+    }
+
+    std::uint64_t operator()()
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 7;
+        m_state ^= m_state << 17;
+        return m_state;
+    }
+
+    /// Random number in [0, bound).
+    std::size_t below(std::size_t bound)
+    {
+        return static_cast<std::size_t>((*this)() % bound);
+    }
+
+  private:
+    std::uint64_t m_state;
+};
+
+/**
+ * @brief Call operation(random) in a loop on threadCount threads for the given duration.
+ *
+ * @return The total number of operations per second, all threads included.
+ */
+template <typename Operation> double run(unsigned threadCount, std::chrono::milliseconds duration, Operation operation)
+{
+    std::atomic<bool> stop{false};
+    std::atomic<unsigned> ready{0};
+    std::atomic<std::uint64_t> total{0};
+
+    std::vector<std::thread> threads;
+    for (unsigned index = 0; index < threadCount; ++index)
+    {
+        threads.emplace_back([&, index]() {
+            Random random(index);
+            std::uint64_t count = 0;
+            ready.fetch_add(1);
+            while (ready.load() != threadCount)
+            {
+                std::this_thread::yield();
+            }
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                operation(random);
+                ++count;
+            }
+            total.fetch_add(count);
+        });
+    }
+
+    while (ready.load() != threadCount)
+    {
+        std::this_thread::yield();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return static_cast<double>(total.load()) / elapsed.count();
+}
+
+/// Prevent the compiler from optimizing away the computation of value.
+template <typename Type> void doNotOptimize(const Type &value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+inline void report(const char *benchmark, const char *variant, unsigned threadCount, double opsPerSecond)
+{
+    switch (format())
+    {
+    case Format::Text:
+        std::printf("%-28s %-28s %4u threads %16.0f ops/s\n", benchmark, variant, threadCount, opsPerSecond);
+        break;
+    case Format::Csv: {
+        static bool header = true;
+        if (header)
+        {
+            std::printf("benchmark,variant,threads,ops_per_second\n");
+            header = false;
+        }
+        // Names contain no double quotes.
+        std::printf("\"%s\",\"%s\",%u,%.0f\n", benchmark, variant, threadCount, opsPerSecond);
+        break;
+    }
+    case Format::Json:
+        std::printf("{\"benchmark\":\"%s\",\"variant\":\"%s\",\"threads\":%u,\"ops_per_second\":%.0f}\n", benchmark,
+                    variant, threadCount, opsPerSecond);
+        break;
+    }
+    std::fflush(stdout);
+}
+} // namespace bench
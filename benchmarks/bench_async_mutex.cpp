@@ -0,0 +1,198 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Many concurrent tasks that each hold the lock across a suspension point (e.g. I/O). With std::mutex, every task needs
+// its own thread. With AsyncMutex, the tasks are coroutines and the thread count stays that of the executor.
+
+#include "bench.h"
+
+#include "safe/async_mutex.h"
+#include "safe/safe.h"
+
+#if __cplusplus >= 202002L
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+constexpr unsigned taskCount = 256;
+
+/// Minimal thread pool that runs coroutines.
+class Executor
+{
+  public:
+    explicit Executor(unsigned threadCount)
+    {
+        for (unsigned index = 0; index < threadCount; ++index)
+        {
+            m_threads.emplace_back([this]() { work(); });
+        }
+    }
+    ~Executor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        for (auto &thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    auto schedule()
+    {
+        struct Awaiter
+        {
+            Executor &executor;
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                executor.post(handle);
+            }
+            void await_resume() const noexcept
+            {
+            }
+        };
+        return Awaiter{*this};
+    }
+
+  private:
+    void post(std::coroutine_handle<> handle)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(handle);
+        }
+        m_condition.notify_one();
+    }
+
+    void work()
+    {
+        while (true)
+        {
+            std::coroutine_handle<> handle;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+                if (m_queue.empty())
+                {
+                    return;
+                }
+                handle = m_queue.front();
+                m_queue.pop_front();
+            }
+            handle.resume();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::coroutine_handle<>> m_queue;
+    bool m_stop = false;
+    std::vector<std::thread> m_threads;
+};
+
+/// Fire-and-forget coroutine.
+struct Task
+{
+    struct promise_type
+    {
+        Task get_return_object() noexcept
+        {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_void() noexcept
+        {
+        }
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+Task task(safe::Safe<std::uint64_t, safe::AsyncMutex> &safeCounter, Executor &executor, std::atomic<bool> &stop,
+          std::atomic<unsigned> &running)
+{
+    co_await executor.schedule();
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        auto counter = co_await safeCounter.asyncWriteLock();
+        co_await executor.schedule();
+        ++*counter;
+    }
+    running.fetch_sub(1);
+}
+
+void coroutines(unsigned threadCount, const bench::Settings &settings)
+{
+    safe::Safe<std::uint64_t, safe::AsyncMutex> safeCounter(0u);
+    std::atomic<bool> stop{false};
+    std::atomic<unsigned> running{taskCount};
+    std::chrono::duration<double> elapsed;
+    {
+        Executor executor(threadCount);
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned index = 0; index < taskCount; ++index)
+        {
+            task(safeCounter, executor, stop, running);
+        }
+        std::this_thread::sleep_for(settings.duration);
+        stop.store(true);
+        while (running.load() != 0)
+        {
+            std::this_thread::yield();
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    bench::report("256 tasks/lock held over I/O", "AsyncMutex/coroutines", threadCount,
+                  static_cast<double>(*safeCounter.readLock()) / elapsed.count());
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    safe::Safe<std::uint64_t> safeCounter(0u);
+    bench::report("256 tasks/lock held over I/O", "std::mutex/threads", taskCount,
+                  bench::run(taskCount, settings.duration, [&](bench::Random &) {
+                      auto counter = safeCounter.writeLock<std::unique_lock>();
+                      std::this_thread::yield();
+                      ++*counter;
+                  }));
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        coroutines(threadCount, settings);
+    }
+}
+#else
+int main()
+{
+}
+#endif // __cplusplus >= 202002L
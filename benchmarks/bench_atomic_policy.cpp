@@ -0,0 +1,50 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Read-mostly workload on a long: compares Safe<long, AtomicPolicy> with the default Safe<long> and with
+// Safe<long, SeqLock>. The call sites are the same for all variants.
+
+#include "bench.h"
+
+#include "safe/atomic_policy.h"
+#include "safe/seqlock.h"
+
+#include <mutex>
+
+namespace
+{
+// One write every writePeriod operations.
+constexpr std::size_t writePeriod = 100;
+
+template <typename SafeType> void benchmark(const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeType safeValue(0);
+        bench::report("read mostly/long", variant, threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          if (random.below(writePeriod) == 0)
+                          {
+                              ++*safeValue.template writeLock<std::unique_lock>();
+                          }
+                          else
+                          {
+                              bench::doNotOptimize(*safeValue.readLock());
+                          }
+                      }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<safe::Safe<long>>("std::mutex", settings);
+    benchmark<safe::Safe<long, safe::SeqLock>>("safe::SeqLock", settings);
+    benchmark<safe::Safe<long, safe::AtomicPolicy>>("safe::AtomicPolicy", settings);
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// For each category of value safe::Auto distinguishes, compares the mutex it chooses with the alternatives, under the
+// workload the choice is made for. All variants use their default lock types.
+
+#include "bench.h"
+
+#include "safe/auto.h"
+
+#if __cplusplus >= 201703L
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+struct Pose
+{
+    double x, y, z;
+    double roll, pitch, yaw;
+};
+using Samples = std::vector<long>;
+constexpr std::size_t sampleCount = 1024;
+
+template <typename SafeType, typename Read, typename Write>
+void benchmark(const char *name, const char *variant, std::size_t writePeriod, Read read, Write write,
+               const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeType safeValue;
+        write(safeValue, 0);
+        bench::report(name, variant, threadCount, bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          if (random.below(writePeriod) == 0)
+                          {
+                              write(safeValue, random.below(sampleCount));
+                          }
+                          else
+                          {
+                              read(safeValue);
+                          }
+                      }));
+    }
+}
+
+template <typename SafeType> void readLong(const SafeType &safeValue)
+{
+    bench::doNotOptimize(*safeValue.readLock());
+}
+template <typename SafeType> void writeLong(SafeType &safeValue, std::size_t value)
+{
+    *safeValue.writeLock() = static_cast<long>(value);
+}
+
+template <typename SafeType> void readPose(const SafeType &safeValue)
+{
+    const Pose pose = *safeValue.readLock();
+    bench::doNotOptimize(pose.x + pose.yaw);
+}
+template <typename SafeType> void writePose(SafeType &safeValue, std::size_t value)
+{
+    const double coordinate = static_cast<double>(value);
+    *safeValue.writeLock() = Pose{coordinate, coordinate, coordinate, 0., 0., coordinate};
+}
+
+template <typename SafeType> void readSamples(const SafeType &safeValue)
+{
+    const auto samples = safeValue.readLock();
+    bench::doNotOptimize(std::accumulate(samples->begin(), samples->end(), 0l));
+}
+template <typename SafeType> void writeSamples(SafeType &safeValue, std::size_t index)
+{
+    auto samples = safeValue.writeLock();
+    samples->resize(sampleCount);
+    ++(*samples)[index];
+}
+
+template <typename SafeType>
+void benchmarkLong(const char *variant, const bench::Settings &settings)
+{
+    benchmark<SafeType>("long, 10% writes", variant, 10, readLong<SafeType>, writeLong<SafeType>, settings);
+}
+template <typename SafeType>
+void benchmarkPose(const char *variant, const bench::Settings &settings)
+{
+    benchmark<SafeType>("Pose (48 B), 10% writes", variant, 10, readPose<SafeType>, writePose<SafeType>, settings);
+}
+template <typename SafeType>
+void benchmarkSamples(const char *name, std::size_t writePeriod, const char *variant, const bench::Settings &settings)
+{
+    benchmark<SafeType>(name, variant, writePeriod, readSamples<SafeType>, writeSamples<SafeType>, settings);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmarkLong<safe::Auto<long>>("Auto (AtomicPolicy)", settings);
+    benchmarkLong<safe::Safe<long, safe::SeqLock>>("SeqLock", settings);
+    benchmarkLong<safe::Safe<long>>("std::mutex", settings);
+
+    benchmarkPose<safe::Auto<Pose>>("Auto (SeqLock)", settings);
+    benchmarkPose<safe::Safe<Pose>>("std::mutex", settings);
+    benchmarkPose<safe::Safe<Pose, safe::DistributedSharedMutex>>("DistributedSharedMutex", settings);
+
+    constexpr const char *readMostly = "1024 longs, 0.1% writes";
+    benchmarkSamples<safe::Auto<Samples, safe::Workload::ReadMostly>>(readMostly, 1000,
+                                                                       "Auto (DistributedSharedMutex)", settings);
+    benchmarkSamples<safe::Safe<Samples>>(readMostly, 1000, "std::mutex", settings);
+
+    constexpr const char *mixed = "1024 longs, 50% writes";
+    benchmarkSamples<safe::Auto<Samples>>(mixed, 2, "Auto (std::mutex)", settings);
+    benchmarkSamples<safe::Safe<Samples, safe::DistributedSharedMutex>>(mixed, 2, "DistributedSharedMutex", settings);
+}
+#else
+int main()
+{
+}
+#endif // __cplusplus >= 201703L
@@ -0,0 +1,66 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Write-heavy job queue: every operation pushes a job to a deque or pops one from it. Compares writeLock() with a
+// std::mutex to apply() with a std::mutex and with a CombiningMutex.
+
+#include "bench.h"
+
+#include "safe/combining_mutex.h"
+#include "safe/safe.h"
+
+#include <deque>
+#include <mutex>
+
+namespace
+{
+using Queue = std::deque<long>;
+
+void operate(Queue &queue, bench::Random &random)
+{
+    if (random.below(2) == 0 || queue.empty())
+    {
+        queue.push_back(static_cast<long>(random()));
+    }
+    else
+    {
+        queue.pop_front();
+    }
+}
+
+template <typename SafeType> void writeLock(SafeType &safeQueue, bench::Random &random)
+{
+    auto queue = safeQueue.template writeLock<std::unique_lock>();
+    operate(*queue, random);
+}
+
+template <typename SafeType> void apply(SafeType &safeQueue, bench::Random &random)
+{
+    safeQueue.apply([&](Queue &queue) { operate(queue, random); });
+}
+
+template <typename SafeType, void (*Operation)(SafeType &, bench::Random &)>
+void benchmark(const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeType safeQueue;
+        bench::report("job queue/push or pop", variant, threadCount,
+                      bench::run(threadCount, settings.duration,
+                                 [&](bench::Random &random) { Operation(safeQueue, random); }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<safe::Safe<Queue>, writeLock>("std::mutex/writeLock", settings);
+    benchmark<safe::Safe<Queue>, apply>("std::mutex/apply", settings);
+    benchmark<safe::Safe<Queue, safe::CombiningMutex>, apply>("CombiningMutex/apply", settings);
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Compares std::mutex with the compact mutexes. Uncontended: increment one of a million Safe<int> objects at random,
+// the footprint of the mutex decides how many objects fit in the caches. Contended: all threads increment the same
+// Safe<int> object.
+
+#include "bench.h"
+
+#include "safe/compact_mutex.h"
+#include "safe/safe.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+constexpr std::size_t objectCount = 1 << 20;
+
+template <typename MutexType> void benchmark(const char *variant, const bench::Settings &settings)
+{
+    using SafeType = safe::Safe<int, MutexType>;
+    if (bench::format() == bench::Format::Text)
+    {
+        std::printf("%-28s %-28s %16zu bytes\n", "sizeof(Safe<int>)", variant, sizeof(SafeType));
+    }
+
+    const std::unique_ptr<SafeType[]> safeValues(new SafeType[objectCount]);
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        bench::report("1M objects", variant, threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          ++*safe::WriteAccess<SafeType>(safeValues[random.below(objectCount)]);
+                      }));
+    }
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        bench::report("1 object", variant, threadCount, bench::run(threadCount, settings.duration, [&](bench::Random &) {
+                          ++*safe::WriteAccess<SafeType>(safeValues[0]);
+                      }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<std::mutex>("std::mutex", settings);
+    benchmark<safe::FutexMutex>("safe::FutexMutex", settings);
+    benchmark<safe::ParkingMutex>("safe::ParkingMutex", settings);
+}
@@ -0,0 +1,127 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Read latency of a large read-mostly map while a writer keeps updating it: compares CowSafe with Safe using
+// std::mutex and std::shared_mutex.
+
+#include "bench.h"
+
+#include "safe/cow_safe.h"
+#include "safe/safe.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#if __cplusplus >= 201703L
+#include <shared_mutex>
+#endif // __cplusplus >= 201703L
+#include <thread>
+#include <vector>
+
+namespace
+{
+using Map = std::map<int, int>;
+constexpr int mapSize = 10000;
+constexpr int updatesPerWrite = 1000;
+
+Map makeMap()
+{
+    Map map;
+    for (int key = 0; key < mapSize; ++key)
+    {
+        map[key] = key;
+    }
+    return map;
+}
+
+template <typename SafeType, template <typename> class ReadLockType>
+void benchmark(const char *variant, const bench::Settings &settings)
+{
+    using Clock = std::chrono::steady_clock;
+
+    const unsigned readerCount = std::max(1u, settings.maxThreads - 1);
+    SafeType safeMap(makeMap());
+    std::atomic<bool> stop{false};
+    std::vector<std::vector<Clock::duration>> latencies(readerCount);
+
+    std::thread writer([&]() {
+        int round = 0;
+        while (!stop.load())
+        {
+            auto map = safeMap.template writeLock<std::unique_lock>();
+            ++round;
+            for (int key = 0; key < updatesPerWrite; ++key)
+            {
+                (*map)[key] = round;
+            }
+        }
+    });
+    std::vector<std::thread> readers;
+    for (unsigned index = 0; index < readerCount; ++index)
+    {
+        readers.emplace_back([&, index]() {
+            bench::Random random(index);
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                const auto start = Clock::now();
+                {
+                    const auto map = safeMap.template readLock<ReadLockType>();
+                    if (map->count(static_cast<int>(random.below(mapSize))) == 0)
+                    {
+                        std::abort();
+                    }
+                }
+                latencies[index].push_back(Clock::now() - start);
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(settings.duration);
+    stop.store(true);
+    writer.join();
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+
+    std::vector<Clock::duration> all;
+    for (const auto &threadLatencies : latencies)
+    {
+        all.insert(all.end(), threadLatencies.begin(), threadLatencies.end());
+    }
+    std::sort(all.begin(), all.end());
+    const auto percentile = [&](double fraction) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   all[static_cast<std::size_t>(fraction * static_cast<double>(all.size() - 1))])
+            .count();
+    };
+    const std::chrono::duration<double> duration = settings.duration;
+    bench::report("read while writing/10k map", variant, readerCount,
+                  static_cast<double>(all.size()) / duration.count());
+    if (bench::format() == bench::Format::Text)
+    {
+        std::printf("%-28s %-28s read latency p50 %lld ns, p99 %lld ns, max %lld ns\n", "", variant,
+                    static_cast<long long>(percentile(0.5)), static_cast<long long>(percentile(0.99)),
+                    static_cast<long long>(percentile(1.0)));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<safe::Safe<Map>, std::unique_lock>("std::mutex", settings);
+#if __cplusplus >= 201703L
+    benchmark<safe::Safe<Map, std::shared_mutex>, std::shared_lock>("std::shared_mutex", settings);
+#endif // __cplusplus >= 201703L
+    benchmark<safe::CowSafe<Map>, std::unique_lock>("safe::CowSafe", settings);
+}
@@ -0,0 +1,60 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Reader scaling: short read accesses from 1 to max threads, without writes and with one write every 1000 accesses.
+// Compares std::shared_mutex, whose readers all modify the same counter, with safe::DistributedSharedMutex.
+
+#include "bench.h"
+
+#include "safe/distributed_shared_mutex.h"
+#include "safe/safe.h"
+
+#if __cplusplus >= 201703L
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+
+namespace
+{
+using Table = std::array<long, 16>;
+
+template <typename SafeType>
+void benchmark(const char *name, std::size_t writePeriod, const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeType safeTable;
+        bench::report(name, variant, threadCount, bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          const std::size_t index = random.below(Table().size());
+                          if (writePeriod != 0 && random.below(writePeriod) == 0)
+                          {
+                              ++safeTable.template writeLock<std::unique_lock>()->at(index);
+                          }
+                          else
+                          {
+                              bench::doNotOptimize(safeTable.template readLock<std::shared_lock>()->at(index));
+                          }
+                      }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<safe::Safe<Table, std::shared_mutex>>("reads", 0, "std::shared_mutex", settings);
+    benchmark<safe::Safe<Table, safe::DistributedSharedMutex>>("reads", 0, "safe::DistributedSharedMutex", settings);
+    benchmark<safe::Safe<Table, std::shared_mutex>>("reads/0.1% writes", 1000, "std::shared_mutex", settings);
+    benchmark<safe::Safe<Table, safe::DistributedSharedMutex>>("reads/0.1% writes", 1000,
+                                                               "safe::DistributedSharedMutex", settings);
+}
+#else
+int main()
+{
+}
+#endif // __cplusplus >= 201703L
@@ -0,0 +1,88 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Table replacement: a background thread keeps replacing a large hash table while the measured threads look keys up.
+// Compares move-assigning through a WriteAccess, which destroys the old table with the mutex locked, with store(),
+// which destroys it after unlocking. In text mode, the mean time the mutex is held by a replacement is also printed.
+
+#include "bench.h"
+
+#include "safe/instrumented_mutex.h"
+#include "safe/safe.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+using Table = std::unordered_map<long, long>;
+using SafeTable = safe::Safe<Table, safe::InstrumentedMutex<>>;
+constexpr long keyCount = 1 << 16;
+
+void assign(SafeTable &safeTable, Table table)
+{
+    safe::WriteAccess<SafeTable> access(safeTable);
+    *access = std::move(table);
+}
+
+void store(SafeTable &safeTable, Table table)
+{
+    safeTable.store(std::move(table));
+}
+
+template <void (*Replace)(SafeTable &, Table)> void benchmark(const char *variant, const bench::Settings &settings)
+{
+    Table table;
+    for (long key = 0; key < keyCount; ++key)
+    {
+        table.emplace(key, key);
+    }
+
+    if (bench::format() == bench::Format::Text)
+    {
+        // Without readers, the mutex is only held by the replacements.
+        constexpr int replacementCount = 20;
+        SafeTable safeTable(table, "table");
+        for (int replacement = 0; replacement < replacementCount; ++replacement)
+        {
+            Replace(safeTable, table);
+        }
+        const safe::ContentionStats stats = safeTable.mutex().stats();
+        std::printf("%-28s %-28s %16.0f ns mean hold\n", "table replacement", variant,
+                    static_cast<double>(stats.hold.totalNanoseconds) / static_cast<double>(stats.acquisitions));
+    }
+
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeTable safeTable(table, "table");
+        std::atomic<bool> stop{false};
+        std::thread replacer([&]() {
+            while (!stop.load())
+            {
+                Replace(safeTable, table);
+            }
+        });
+        bench::report("lookups/table replaced", variant, threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          const auto key = static_cast<long>(random.below(keyCount));
+                          bench::doNotOptimize(safe::ReadAccess<SafeTable>(safeTable)->count(key));
+                      }));
+        stop.store(true);
+        replacer.join();
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<assign>("*writeLock() = move(table)", settings);
+    benchmark<store>("store(move(table))", settings);
+}
@@ -0,0 +1,147 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Periodic sweep over sessions: a background thread keeps a fraction of the sessions locked, each one for a while,
+// while the measured threads sweep all sessions. Compares calling writeLock() on each session, which waits behind the
+// busy ones, with safe::forEachLocked(), which visits them last. The thread count is the number of threads
+// forEachLocked() splits the sweep between; the writeLock() loop always uses one thread. Each operation is a whole
+// sweep.
+//
+// Usage: [--contended=percent] [--csv|--json] [max threads] [milliseconds per run]. Without --contended, 0.1 % and then
+// 1 % of the sessions are contended.
+
+#include "bench.h"
+
+#include "safe/for_each_locked.h"
+#include "safe/safe.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct Session
+{
+    long bytes = 0;
+    long expiry = 0;
+};
+using SafeSession = safe::Safe<Session>;
+constexpr std::size_t sessionCount = 1 << 14;
+
+void expire(Session &session)
+{
+    session.bytes = 0;
+    ++session.expiry;
+}
+
+/**
+ * @brief Keeps heldCount sessions locked, replacing the oldest one with a random one every 20 microseconds.
+ */
+class Contention
+{
+  public:
+    Contention(std::vector<SafeSession> &sessions, std::size_t heldCount)
+        : m_thread([this, &sessions, heldCount]() { run(sessions, heldCount); })
+    {
+        while (!m_ready.load())
+        {
+            std::this_thread::yield();
+        }
+    }
+    ~Contention()
+    {
+        m_stop.store(true);
+        m_thread.join();
+    }
+
+  private:
+    void run(std::vector<SafeSession> &sessions, std::size_t heldCount)
+    {
+        bench::Random random(42);
+        std::vector<bool> held(sessions.size(), false);
+        std::deque<std::size_t> order;
+        std::deque<std::unique_lock<std::mutex>> locks;
+        while (!m_stop.load())
+        {
+            if (locks.size() < heldCount)
+            {
+                std::size_t index;
+                do
+                {
+                    index = random.below(sessions.size());
+                } while (held[index]);
+                held[index] = true;
+                order.push_back(index);
+                locks.emplace_back(sessions[index].mutex());
+                continue;
+            }
+            m_ready.store(true);
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+            if (!locks.empty())
+            {
+                held[order.front()] = false;
+                order.pop_front();
+                locks.pop_front();
+            }
+        }
+    }
+
+    std::atomic<bool> m_ready{false};
+    std::atomic<bool> m_stop{false};
+    std::thread m_thread;
+};
+
+void benchmark(double contendedPercent, const bench::Settings &settings)
+{
+    std::vector<SafeSession> sessions(sessionCount);
+    const std::string name = "sweep, " + std::to_string(contendedPercent).substr(0, 4) + " % busy";
+    Contention contention(sessions, static_cast<std::size_t>(contendedPercent / 100.0 * sessionCount));
+
+    bench::report(name.c_str(), "writeLock() each", 1, bench::run(1, settings.duration, [&](bench::Random &) {
+                      for (SafeSession &session : sessions)
+                      {
+                          expire(*session.writeLock());
+                      }
+                  }));
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        bench::report(name.c_str(), "forEachLocked", threadCount, bench::run(1, settings.duration, [&](bench::Random &) {
+                          safe::forEachLocked(sessions, expire, threadCount);
+                      }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<double> contendedPercents{0.1, 1.0};
+    std::vector<char *> arguments;
+    for (int index = 0; index < argc; ++index)
+    {
+        if (std::strncmp(argv[index], "--contended=", 12) == 0)
+        {
+            contendedPercents.assign(1, std::strtod(argv[index] + 12, nullptr));
+        }
+        else
+        {
+            arguments.push_back(argv[index]);
+        }
+    }
+    const bench::Settings settings = bench::parseSettings(static_cast<int>(arguments.size()), arguments.data());
+
+    for (const double contendedPercent : contendedPercents)
+    {
+        benchmark(contendedPercent, settings);
+    }
+}
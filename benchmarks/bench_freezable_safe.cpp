@@ -0,0 +1,58 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Read-mostly configuration: a table is filled once, then only looked up. Compares read accesses to a Safe object,
+// which lock the mutex every time, with read accesses to a frozen FreezableSafe object, which do not.
+
+#include "bench.h"
+
+#include "safe/freezable_safe.h"
+#include "safe/safe.h"
+
+#include <unordered_map>
+
+namespace
+{
+using Table = std::unordered_map<long, long>;
+constexpr long keyCount = 1 << 12;
+
+template <typename SafeType> void fill(SafeType &safeTable)
+{
+    safe::WriteAccess<SafeType> table(safeTable);
+    for (long key = 0; key < keyCount; ++key)
+    {
+        table->emplace(key, key);
+    }
+}
+
+template <typename SafeType>
+void benchmark(const char *variant, SafeType &safeTable, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        bench::report("lookups", variant, threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          const auto key = static_cast<long>(random.below(keyCount));
+                          bench::doNotOptimize(safeTable.readLock()->count(key));
+                      }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    safe::Safe<Table> safeTable;
+    fill(safeTable);
+    benchmark("Safe", safeTable, settings);
+
+    safe::FreezableSafe<Table> freezableTable;
+    fill(freezableTable);
+    freezableTable.freeze();
+    benchmark("frozen FreezableSafe", freezableTable, settings);
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Overhead of InstrumentedMutex: lock/unlock of a Safe object with and without instrumentation. The single-thread run
+// measures the uncontended overhead (two clock reads and a few uncontended stores per acquisition), the other runs the
+// overhead under contention.
+
+#include "bench.h"
+
+#include "safe/instrumented_mutex.h"
+#include "safe/safe.h"
+
+#include <mutex>
+
+namespace
+{
+template <typename SafeType> void benchmark(const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeType safeCounter(0);
+        bench::report("lock/increment/unlock", variant, threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &) { ++*safeCounter.writeLock(); }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<safe::Safe<long>>("std::mutex", settings);
+    benchmark<safe::Safe<long, safe::InstrumentedMutex<>>>("InstrumentedMutex", settings);
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// False sharing: each thread increments its own Safe object, the Safe objects being adjacent in an array. Compares
+// the default layout with PaddedMutex (mutex and value on separate cache lines) and Aligned (each Safe object on its
+// own cache lines).
+
+#include "bench.h"
+
+#include "safe/cache_line.h"
+#include "safe/safe.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+namespace
+{
+constexpr unsigned maxThreads = 256;
+
+template <typename SafeType> void benchmark(const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(std::min(settings.maxThreads, maxThreads)))
+    {
+        SafeType safeCounters[maxThreads];
+        std::atomic<unsigned> nextIndex{0};
+        bench::report("adjacent Safe objects", variant, threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &) {
+                          thread_local unsigned index = nextIndex.fetch_add(1);
+                          ++*safeCounters[index].template writeLock<std::unique_lock>();
+                      }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<safe::Safe<long>>("default layout", settings);
+    benchmark<safe::Safe<long, safe::PaddedMutex<std::mutex>>>("PaddedMutex", settings);
+    benchmark<safe::Aligned<safe::Safe<long>>>("Aligned", settings);
+}
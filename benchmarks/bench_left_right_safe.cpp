@@ -0,0 +1,72 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Read-mostly workload on a large value: compares LeftRightSafe with CowSafe and with Safe using std::mutex and
+// std::shared_mutex.
+
+#include "bench.h"
+
+#include "safe/cow_safe.h"
+#include "safe/left_right_safe.h"
+#include "safe/safe.h"
+
+#include <cstdlib>
+#include <mutex>
+#if __cplusplus >= 201703L
+#include <shared_mutex>
+#endif // __cplusplus >= 201703L
+#include <vector>
+
+namespace
+{
+using Index = std::vector<long>;
+constexpr std::size_t indexSize = 4096;
+// One write every writePeriod operations.
+constexpr std::size_t writePeriod = 1000;
+
+template <typename SafeType, typename Function> void write(SafeType &safeIndex, Function function)
+{
+    function(*safeIndex.template writeLock<std::unique_lock>());
+}
+template <typename Function> void write(safe::LeftRightSafe<Index> &safeIndex, Function function)
+{
+    safeIndex.apply(function);
+}
+
+template <typename SafeType, template <typename> class ReadLockType>
+void benchmark(const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeType safeIndex(indexSize, 0l);
+        bench::report("read mostly/32 KiB", variant, threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          const std::size_t position = random.below(indexSize);
+                          if (random.below(writePeriod) == 0)
+                          {
+                              write(safeIndex, [position](Index &index) { ++index[position]; });
+                          }
+                          else if (safeIndex.template readLock<ReadLockType>()->at(position) < 0)
+                          {
+                              std::abort();
+                          }
+                      }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<safe::Safe<Index>, std::unique_lock>("std::mutex", settings);
+#if __cplusplus >= 201703L
+    benchmark<safe::Safe<Index, std::shared_mutex>, std::shared_lock>("std::shared_mutex", settings);
+#endif // __cplusplus >= 201703L
+    benchmark<safe::CowSafe<Index>, std::unique_lock>("safe::CowSafe", settings);
+    benchmark<safe::LeftRightSafe<Index>, std::unique_lock>("safe::LeftRightSafe", settings);
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Cross-transfer workload: every operation moves one unit between two random accounts, each account being a Safe
+// object. Compares safe::lockAll with locking the two accounts in a global (index) order, and with std::lock.
+
+#include "bench.h"
+
+#include "safe/lock_all.h"
+
+#include <cstddef>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace
+{
+using Account = safe::Safe<long>;
+
+std::pair<std::size_t, std::size_t> pickTwo(bench::Random &random, std::size_t accountCount)
+{
+    const std::size_t from = random.below(accountCount);
+    const std::size_t to = (from + 1 + random.below(accountCount - 1)) % accountCount;
+    return {from, to};
+}
+
+void orderedTransfer(std::vector<Account> &accounts, bench::Random &random)
+{
+    const auto pair = pickTwo(random, accounts.size());
+    auto lower = accounts[std::min(pair.first, pair.second)].writeLock<std::unique_lock>();
+    auto higher = accounts[std::max(pair.first, pair.second)].writeLock<std::unique_lock>();
+    if (pair.first < pair.second)
+    {
+        --*lower;
+        ++*higher;
+    }
+    else
+    {
+        --*higher;
+        ++*lower;
+    }
+}
+
+void stdLockTransfer(std::vector<Account> &accounts, bench::Random &random)
+{
+    const auto pair = pickTwo(random, accounts.size());
+    auto from = accounts[pair.first].writeLock<std::unique_lock>(std::defer_lock);
+    auto to = accounts[pair.second].writeLock<std::unique_lock>(std::defer_lock);
+    std::lock(from.lock, to.lock);
+    --*from;
+    ++*to;
+}
+
+void lockAllTransfer(std::vector<Account> &accounts, bench::Random &random)
+{
+    const auto pair = pickTwo(random, accounts.size());
+    auto accesses = safe::lockAll(accounts[pair.first], accounts[pair.second]);
+    --*std::get<0>(accesses);
+    ++*std::get<1>(accesses);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    for (const std::size_t accountCount : {4u, 64u, 4096u})
+    {
+        for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+        {
+            std::vector<Account> accounts(accountCount);
+            char name[32];
+            std::snprintf(name, sizeof(name), "transfer/%zu accounts", accountCount);
+
+            bench::report(name, "ordered", threadCount,
+                          bench::run(threadCount, settings.duration,
+                                     [&](bench::Random &random) { orderedTransfer(accounts, random); }));
+            bench::report(name, "std::lock", threadCount,
+                          bench::run(threadCount, settings.duration,
+                                     [&](bench::Random &random) { stdLockTransfer(accounts, random); }));
+            bench::report(name, "safe::lockAll", threadCount,
+                          bench::run(threadCount, settings.duration,
+                                     [&](bench::Random &random) { lockAllTransfer(accounts, random); }));
+        }
+    }
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Cost of readLock()/writeLock() across a matrix of scenarios: read ratio, value size, mutex type and lock type, for
+// every thread count. Run with --csv or --json to track the results across releases, for instance:
+//   safe_bench --csv 8 100 > results.csv
+
+#include "bench.h"
+
+#include "safe/safe.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#if __cplusplus >= 201703L
+#include <shared_mutex>
+#endif // __cplusplus >= 201703L
+#include <thread>
+
+namespace
+{
+/// Test-and-test-and-set spinlock, yielding while the lock is taken.
+class SpinLock
+{
+  public:
+    void lock() noexcept
+    {
+        while (!try_lock())
+        {
+            while (m_locked.load(std::memory_order_relaxed))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+    bool try_lock() noexcept
+    {
+        return !m_locked.exchange(true, std::memory_order_acquire);
+    }
+    void unlock() noexcept
+    {
+        m_locked.store(false, std::memory_order_release);
+    }
+
+  private:
+    std::atomic<bool> m_locked{false};
+};
+
+/// A value of Size bytes.
+template <std::size_t Size> struct Payload
+{
+    unsigned char bytes[Size];
+};
+
+constexpr unsigned readPercents[] = {0, 50, 90, 99, 100};
+
+/**
+ * @brief Run one variant for all read ratios and thread counts. Reads copy the value out of the Safe object, writes
+ * copy a value into it.
+ */
+template <typename ValueType, typename MutexType, template <typename> class ReadLockType,
+          template <typename> class WriteLockType>
+void benchmark(const char *valueName, const char *variant, const bench::Settings &settings)
+{
+    using SafeType = safe::Safe<ValueType, MutexType>;
+
+    for (const unsigned readPercent : readPercents)
+    {
+        const std::string name = std::to_string(readPercent) + "% reads/" + valueName;
+        for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+        {
+            SafeType safeValue{ValueType()};
+            bench::report(name.c_str(), variant, threadCount,
+                          bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                              if (random.below(100) < readPercent)
+                              {
+                                  safe::ReadAccess<SafeType, ReadLockType> value(safeValue);
+                                  const ValueType copy = *value;
+                                  bench::doNotOptimize(copy);
+                              }
+                              else
+                              {
+                                  ValueType copy = ValueType();
+                                  bench::doNotOptimize(copy);
+                                  safe::WriteAccess<SafeType, WriteLockType> value(safeValue);
+                                  *value = copy;
+                              }
+                          }));
+        }
+    }
+}
+
+template <typename ValueType> void benchmarkAll(const char *valueName, const bench::Settings &settings)
+{
+    benchmark<ValueType, std::mutex, std::lock_guard, std::lock_guard>(valueName, "std::mutex/lock_guard", settings);
+    benchmark<ValueType, std::mutex, std::unique_lock, std::unique_lock>(valueName, "std::mutex/unique_lock",
+                                                                         settings);
+    benchmark<ValueType, std::timed_mutex, std::lock_guard, std::lock_guard>(valueName, "std::timed_mutex/lock_guard",
+                                                                             settings);
+    benchmark<ValueType, std::timed_mutex, std::unique_lock, std::unique_lock>(valueName,
+                                                                               "std::timed_mutex/unique_lock", settings);
+    benchmark<ValueType, SpinLock, std::lock_guard, std::lock_guard>(valueName, "spinlock/lock_guard", settings);
+    benchmark<ValueType, SpinLock, std::unique_lock, std::unique_lock>(valueName, "spinlock/unique_lock", settings);
+#if __cplusplus >= 201703L
+    benchmark<ValueType, std::shared_mutex, std::lock_guard, std::lock_guard>(valueName,
+                                                                              "std::shared_mutex/lock_guard", settings);
+    benchmark<ValueType, std::shared_mutex, std::unique_lock, std::unique_lock>(
+        valueName, "std::shared_mutex/unique_lock", settings);
+    benchmark<ValueType, std::shared_mutex, std::shared_lock, std::lock_guard>(
+        valueName, "std::shared_mutex/shared_lock", settings);
+#endif // __cplusplus >= 201703L
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmarkAll<int>("int", settings);
+    benchmarkAll<Payload<64>>("64 bytes", settings);
+    benchmarkAll<Payload<512>>("512 bytes", settings);
+    benchmarkAll<Payload<4096>>("4 KiB", settings);
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Short critical sections under contention: compares std::mutex, a test-and-set spinlock and safe::McsLock. Each thread
+// counts its own critical sections in the protected value. In text mode, fairness is also printed: the smallest count
+// of any thread divided by the largest.
+
+#include "bench.h"
+
+#include "safe/mcs_lock.h"
+#include "safe/safe.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+class SpinLock
+{
+  public:
+    void lock() noexcept
+    {
+        while (!try_lock())
+        {
+            while (m_locked.load(std::memory_order_relaxed))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+    bool try_lock() noexcept
+    {
+        return !m_locked.exchange(true, std::memory_order_acquire);
+    }
+    void unlock() noexcept
+    {
+        m_locked.store(false, std::memory_order_release);
+    }
+
+  private:
+    std::atomic<bool> m_locked{false};
+};
+
+template <typename MutexType> void benchmark(const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        safe::Safe<std::vector<std::uint64_t>, MutexType> safeCounts(threadCount, 0);
+        std::atomic<unsigned> nextIndex{0};
+        bench::report("short critical sections", variant, threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &) {
+                          thread_local unsigned index = nextIndex.fetch_add(1);
+                          safeCounts.apply([](std::vector<std::uint64_t> &counts) { ++counts[index]; });
+                      }));
+        if (bench::format() == bench::Format::Text)
+        {
+            const auto &counts = safeCounts.unsafe();
+            const auto minMax = std::minmax_element(counts.begin(), counts.end());
+            std::printf("%-28s %-28s %4u threads %16.2f fairness\n", "", "", threadCount,
+                        static_cast<double>(*minMax.first) / static_cast<double>(*minMax.second));
+        }
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<std::mutex>("std::mutex", settings);
+    benchmark<SpinLock>("spinlock", settings);
+    benchmark<safe::McsLock>("safe::McsLock", settings);
+}
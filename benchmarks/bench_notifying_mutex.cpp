@@ -0,0 +1,131 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Job queue: one producer pushes jobs for the given duration, consumers wait for jobs. Compares a separate
+// std::condition_variable (notify_all and notify_one on every push) with Safe::waitUntil() on a NotifyingMutex. Also
+// reports the CPU time spent per job, which includes the cost of spurious wakeups.
+
+#include "bench.h"
+
+#include "safe/notifying_mutex.h"
+#include "safe/safe.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using Jobs = std::deque<long>;
+// A negative job stops a consumer.
+constexpr long stopJob = -1;
+
+/// Safe object paired with a separate condition variable, the producer notifies on every push.
+template <bool NotifyAll> struct ConditionVariableQueue
+{
+    void push(long job)
+    {
+        safeJobs.writeLock()->push_back(job);
+        if (NotifyAll)
+        {
+            condition.notify_all();
+        }
+        else
+        {
+            condition.notify_one();
+        }
+    }
+    long pop()
+    {
+        auto jobs = safeJobs.writeLock<std::unique_lock>();
+        condition.wait(jobs.lock, [&]() { return !jobs->empty(); });
+        const long job = jobs->front();
+        jobs->pop_front();
+        return job;
+    }
+
+    safe::Safe<Jobs> safeJobs;
+    std::condition_variable condition;
+};
+
+struct NotifyingQueue
+{
+    void push(long job)
+    {
+        safeJobs.writeLock()->push_back(job);
+    }
+    long pop()
+    {
+        auto jobs = safeJobs.waitUntil([](const Jobs &jobs) { return !jobs.empty(); });
+        const long job = jobs->front();
+        jobs->pop_front();
+        return job;
+    }
+
+    safe::Safe<Jobs, safe::NotifyingMutex> safeJobs;
+};
+
+template <typename Queue> void benchmark(const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned consumerCount : bench::threadCounts(settings.maxThreads))
+    {
+        Queue queue;
+        std::vector<std::thread> consumers;
+        for (unsigned consumer = 0; consumer < consumerCount; ++consumer)
+        {
+            consumers.emplace_back([&]() {
+                while (queue.pop() != stopJob)
+                {
+                }
+            });
+        }
+
+        const std::clock_t cpuStart = std::clock();
+        const auto start = std::chrono::steady_clock::now();
+        long jobCount = 0;
+        while (std::chrono::steady_clock::now() - start < settings.duration)
+        {
+            for (int batch = 0; batch < 64; ++batch)
+            {
+                queue.push(jobCount++);
+            }
+        }
+        for (unsigned consumer = 0; consumer < consumerCount; ++consumer)
+        {
+            queue.push(stopJob);
+        }
+        for (auto &consumer : consumers)
+        {
+            consumer.join();
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+        bench::report("job queue/1 producer", variant, consumerCount, static_cast<double>(jobCount) / elapsed.count());
+        if (bench::format() == bench::Format::Text)
+        {
+            std::printf("%-28s %-28s CPU time per job %.0f ns\n", "", variant,
+                        1e9 * cpuSeconds / static_cast<double>(jobCount));
+        }
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<ConditionVariableQueue<true>>("condition_variable/all", settings);
+    benchmark<ConditionVariableQueue<false>>("condition_variable/one", settings);
+    benchmark<NotifyingQueue>("NotifyingMutex/waitUntil", settings);
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Map churn: each operation inserts a random key into a hash map and erases another one, so that every critical
+// section allocates and deallocates a node. Compares the global allocator with the unsynchronized pool resource of
+// a PmrSafe object. In text mode, the mean time the mutex is held per operation is also printed.
+//
+// Map rebuild: each operation inserts a new key, and the map is emptied every 4096 keys. Compares the global allocator
+// and clear() with a monotonic buffer resource and PmrSafe::reset(), which frees all nodes at once.
+
+#include "bench.h"
+
+#include "safe/instrumented_mutex.h"
+#include "safe/pmr_safe.h"
+#include "safe/safe.h"
+
+#if __cplusplus >= 201703L
+#include <atomic>
+#include <cstdio>
+#include <memory_resource>
+#include <unordered_map>
+
+namespace
+{
+constexpr long keyCount = 1 << 14;
+
+template <typename SafeType> void churn(SafeType &safeMap, bench::Random &random)
+{
+    auto map = safeMap.writeLock();
+    map->emplace(static_cast<long>(random.below(keyCount)), 0);
+    map->erase(static_cast<long>(random.below(keyCount)));
+}
+
+constexpr long rebuildSize = 4096;
+
+void empty(safe::Safe<std::unordered_map<long, long>> &safeMap)
+{
+    safeMap.writeLock()->clear();
+}
+void empty(safe::PmrSafe<std::pmr::unordered_map<long, long>, std::pmr::monotonic_buffer_resource> &safeMap)
+{
+    safeMap.reset();
+}
+
+template <typename SafeType> void rebuild(const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeType safeMap;
+        std::atomic<long> nextKey{0};
+        bench::report("map rebuild", variant, threadCount, bench::run(threadCount, settings.duration, [&](bench::Random &) {
+                          const long key = nextKey.fetch_add(1, std::memory_order_relaxed);
+                          safeMap.writeLock()->emplace(key, key);
+                          if ((key + 1) % rebuildSize == 0)
+                          {
+                              empty(safeMap);
+                          }
+                      }));
+    }
+}
+
+template <typename SafeType> void benchmark(const char *variant, const bench::Settings &settings)
+{
+    if (bench::format() == bench::Format::Text)
+    {
+        constexpr int operationCount = 1 << 18;
+        SafeType safeMap;
+        bench::Random random(0);
+        for (int operation = 0; operation < operationCount; ++operation)
+        {
+            churn(safeMap, random);
+        }
+        const safe::ContentionStats stats = safeMap.mutex().stats();
+        std::printf("%-28s %-28s %16.0f ns mean hold\n", "map churn", variant,
+                    static_cast<double>(stats.hold.totalNanoseconds) / static_cast<double>(stats.acquisitions));
+    }
+
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeType safeMap;
+        bench::report("map churn", variant, threadCount,
+                      bench::run(threadCount, settings.duration,
+                                 [&](bench::Random &random) { churn(safeMap, random); }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<safe::Safe<std::unordered_map<long, long>, safe::InstrumentedMutex<>>>("global allocator", settings);
+    benchmark<safe::PmrSafe<std::pmr::unordered_map<long, long>, std::pmr::unsynchronized_pool_resource,
+                            safe::InstrumentedMutex<>>>("PmrSafe, pool resource", settings);
+
+    rebuild<safe::Safe<std::unordered_map<long, long>>>("global allocator, clear()", settings);
+    rebuild<safe::PmrSafe<std::pmr::unordered_map<long, long>, std::pmr::monotonic_buffer_resource>>(
+        "PmrSafe, monotonic, reset()", settings);
+}
+#else
+int main()
+{
+}
+#endif // __cplusplus >= 201703L
@@ -0,0 +1,56 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Metrics aggregation: producers add samples to a histogram. Compares locking the histogram for each sample with
+// posting the update to a safe::PostingMutex, drained by a safe::Strand. Only the producers are measured.
+
+#include "bench.h"
+
+#include "safe/posting_mutex.h"
+#include "safe/safe.h"
+
+#include <array>
+#include <mutex>
+
+namespace
+{
+using Histogram = std::array<long, 64>;
+
+void benchmarkWriteLock(const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        safe::Safe<Histogram> safeHistogram{Histogram()};
+        bench::report("histogram updates", "writeLock", threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          ++safeHistogram.writeLock<std::unique_lock>()->at(random.below(Histogram().size()));
+                      }));
+    }
+}
+
+void benchmarkPost(const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        safe::Safe<Histogram, safe::PostingMutex> safeHistogram{Histogram()};
+        safe::Strand<safe::Safe<Histogram, safe::PostingMutex>> strand(safeHistogram);
+        bench::report("histogram updates", "post", threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          const std::size_t bucket = random.below(Histogram().size());
+                          safeHistogram.post([bucket](Histogram &histogram) { ++histogram[bucket]; });
+                      }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmarkWriteLock(settings);
+    benchmarkPost(settings);
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Read-mostly workload on a small trivially copyable value: compares Safe<Quote, SeqLock> with Safe<Quote,
+// std::shared_mutex> read through std::shared_lock, and with the default Safe<Quote>.
+
+#include "bench.h"
+
+#include "safe/seqlock.h"
+
+#include <cstdlib>
+#include <mutex>
+#if __cplusplus >= 201703L
+#include <shared_mutex>
+#endif // __cplusplus >= 201703L
+
+namespace
+{
+struct Quote
+{
+    long bid;
+    long ask;
+    long bidSize;
+    long askSize;
+};
+
+// One write every writePeriod operations.
+constexpr std::size_t writePeriod = 1000;
+
+template <typename SafeType, template <typename> class ReadLockType>
+void readMostly(SafeType &safeQuote, bench::Random &random)
+{
+    if (random.below(writePeriod) == 0)
+    {
+        auto quote = safeQuote.template writeLock<std::unique_lock>();
+        ++quote->bid;
+        ++quote->ask;
+    }
+    else
+    {
+        const auto quote = safeQuote.template readLock<ReadLockType>();
+        if (quote->ask != quote->bid + 1)
+        {
+            std::abort();
+        }
+    }
+}
+
+template <typename SafeType, template <typename> class ReadLockType>
+void benchmark(const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeType safeQuote(Quote{0, 1, 0, 0});
+        bench::report("read mostly/32 bytes", variant, threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          readMostly<SafeType, ReadLockType>(safeQuote, random);
+                      }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<safe::Safe<Quote>, std::unique_lock>("std::mutex", settings);
+#if __cplusplus >= 201703L
+    benchmark<safe::Safe<Quote, std::shared_mutex>, std::shared_lock>("std::shared_mutex", settings);
+#endif // __cplusplus >= 201703L
+    benchmark<safe::Safe<Quote, safe::SeqLock>, std::unique_lock>("safe::SeqLock", settings);
+}
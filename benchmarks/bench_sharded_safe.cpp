@@ -0,0 +1,72 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Uniformly distributed lookups and updates on an unordered_map: compares ShardedSafe with a single Safe.
+
+#include "bench.h"
+
+#include "safe/safe.h"
+#include "safe/sharded_safe.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+using Map = std::unordered_map<long, long>;
+constexpr std::size_t keyCount = 1 << 16;
+// One update every updatePeriod operations.
+constexpr std::size_t updatePeriod = 4;
+
+void operate(safe::Safe<Map> &safeMap, long key, bool update)
+{
+    auto map = safeMap.writeLock<std::unique_lock>();
+    if (update)
+    {
+        ++(*map)[key];
+    }
+    else
+    {
+        map->find(key);
+    }
+}
+
+template <typename ShardedType> void operate(ShardedType &shardedMap, long key, bool update)
+{
+    auto map = shardedMap.template writeLock<std::unique_lock>(key);
+    if (update)
+    {
+        ++(*map)[key];
+    }
+    else
+    {
+        map->find(key);
+    }
+}
+
+template <typename SafeType> void benchmark(const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeType safeMap;
+        bench::report("uniform keys/25% updates", variant, threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          operate(safeMap, static_cast<long>(random.below(keyCount)),
+                                  random.below(updatePeriod) == 0);
+                      }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<safe::Safe<Map>>("safe::Safe", settings);
+    benchmark<safe::ShardedSafe<Map, 16>>("safe::ShardedSafe<16>", settings);
+    benchmark<safe::ShardedSafe<Map, 256>>("safe::ShardedSafe<256>", settings);
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Cache fill: look a key up and insert it if it is missing, while other operations evict keys. Compares releasing the
+// read lock and re-checking under a write lock with upgrading an UpgradeAccess.
+
+#include "bench.h"
+
+#include "safe/safe.h"
+#include "safe/upgrade_mutex.h"
+
+#if __cplusplus >= 201402L
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace
+{
+using Cache = std::unordered_map<long, long>;
+constexpr std::size_t keyCount = 1 << 10;
+// One eviction every evictionPeriod operations.
+constexpr std::size_t evictionPeriod = 10;
+
+template <typename SafeType> void evict(SafeType &safeCache, long key)
+{
+    safeCache.template writeLock<std::unique_lock>()->erase(key);
+}
+
+template <typename SafeType> long relock(SafeType &safeCache, long key)
+{
+    {
+        const auto cache = safeCache.template readLock<std::shared_lock>();
+        const auto found = cache->find(key);
+        if (found != cache->end())
+        {
+            return found->second;
+        }
+    }
+    auto cache = safeCache.template writeLock<std::unique_lock>();
+    const auto found = cache->find(key);
+    if (found != cache->end())
+    {
+        return found->second;
+    }
+    return (*cache)[key] = key;
+}
+
+template <typename SafeType> long upgrade(SafeType &safeCache, long key)
+{
+    auto cache = safeCache.upgradeLock();
+    const auto found = cache->find(key);
+    if (found != cache->end())
+    {
+        return found->second;
+    }
+    return (*cache.upgrade())[key] = key;
+}
+
+template <typename SafeType, long (*Fill)(SafeType &, long)>
+void benchmark(const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeType safeCache;
+        bench::report("cache fill/10% evictions", variant, threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          const long key = static_cast<long>(random.below(keyCount));
+                          if (random.below(evictionPeriod) == 0)
+                          {
+                              evict(safeCache, key);
+                          }
+                          else
+                          {
+                              bench::doNotOptimize(Fill(safeCache, key));
+                          }
+                      }));
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+#if __cplusplus >= 201703L
+    benchmark<safe::Safe<Cache, std::shared_mutex>, relock>("shared_mutex/relock", settings);
+#endif // __cplusplus >= 201703L
+    benchmark<safe::Safe<Cache, safe::UpgradeMutex>, relock>("UpgradeMutex/relock", settings);
+    benchmark<safe::Safe<Cache, safe::UpgradeMutex>, upgrade>("UpgradeMutex/upgrade", settings);
+}
+#else
+int main()
+{
+}
+#endif // __cplusplus >= 201402L
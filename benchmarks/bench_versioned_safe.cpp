@@ -0,0 +1,81 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+// Expensive derived state: a background thread keeps recomputing a table from its previous contents while the measured
+// threads read it. Compares computing with the mutex locked for writing with VersionedSafe::update(), which computes
+// on a copy with the mutex unlocked and only locks it to commit. Part of each recomputation is a 1 ms sleep, which
+// stands for waiting on another service, so that the comparison holds on machines with few cores.
+
+#include "bench.h"
+
+#include "safe/versioned_safe.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using Table = std::vector<double>;
+using SafeTable = safe::VersionedSafe<Table>;
+constexpr std::size_t tableSize = 1 << 12;
+
+void recompute(Table &table)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    for (int round = 0; round < 16; ++round)
+    {
+        for (std::size_t index = 1; index < table.size(); ++index)
+        {
+            table[index] = std::sqrt(table[index] + table[index - 1]);
+        }
+    }
+}
+
+void computeLocked(SafeTable &safeTable)
+{
+    safe::WriteAccess<SafeTable> table(safeTable);
+    recompute(*table);
+}
+
+void computeUnlocked(SafeTable &safeTable)
+{
+    safeTable.update(recompute);
+}
+
+template <void (*Update)(SafeTable &)> void benchmark(const char *variant, const bench::Settings &settings)
+{
+    for (const unsigned threadCount : bench::threadCounts(settings.maxThreads))
+    {
+        SafeTable safeTable(tableSize, 1.0);
+        std::atomic<bool> stop{false};
+        std::thread updater([&]() {
+            while (!stop.load())
+            {
+                Update(safeTable);
+            }
+        });
+        bench::report("lookups/table recomputed", variant, threadCount,
+                      bench::run(threadCount, settings.duration, [&](bench::Random &random) {
+                          bench::doNotOptimize((*safeTable.readLock())[random.below(tableSize)]);
+                      }));
+        stop.store(true);
+        updater.join();
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const bench::Settings settings = bench::parseSettings(argc, argv);
+
+    benchmark<computeLocked>("compute under writeLock()", settings);
+    benchmark<computeUnlocked>("update()", settings);
+}
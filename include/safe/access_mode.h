@@ -17,7 +17,9 @@ namespace safe
 enum class AccessMode
 {
     ReadOnly,
-    ReadWrite
+    ReadWrite,
+    /// Read-only access that excludes writers and other upgraders, and can be upgraded to ReadWrite.
+    Upgradeable
 };
 
 // Base template: most LockTypes are not read only.
@@ -0,0 +1,253 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#if __cplusplus >= 202002L
+#include <condition_variable>
+#include <coroutine>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace safe
+{
+/**
+ * @brief Mutex that coroutines can lock without blocking their thread: co_await mutex.lockAsync() suspends the
+ * coroutine until the mutex is unlocked. Suspended coroutines are queued in order, and unlocking the mutex hands it over
+ * to the first one.
+ *
+ * The coroutine that is handed the mutex is given to the scheduler passed to the constructor, if any, which decides
+ * where it resumes. Otherwise, it resumes on the thread that unlocks the mutex: right away if that thread does not run
+ * a coroutine resumed by an AsyncMutex, or else as soon as that coroutine suspends or returns. The stack does not grow
+ * with the number of waiting coroutines, but a coroutine must not block its thread on an AsyncMutex with lock().
+ *
+ * The mutex can also be locked by blocking the thread, with lock(). It can be unlocked from any thread. When both
+ * threads and coroutines wait, unlocking hands the mutex over alternately to a thread and to a coroutine, so neither
+ * can starve the other.
+ */
+class AsyncMutex
+{
+  public:
+    /**
+     * @brief Awaitable returned by lockAsync(). The mutex is locked when the co_await expression completes.
+     */
+    class LockAwaiter
+    {
+      public:
+        explicit LockAwaiter(AsyncMutex &mutex) noexcept : m_mutex(mutex)
+        {
+        }
+
+        bool await_ready() noexcept
+        {
+            return m_mutex.try_lock();
+        }
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            m_handle = handle;
+            return m_mutex.enqueue(*this);
+        }
+        void await_resume() const noexcept
+        {
+        }
+
+      private:
+        friend class AsyncMutex;
+
+        AsyncMutex &m_mutex;
+        std::coroutine_handle<> m_handle;
+        LockAwaiter *m_next = nullptr;
+    };
+
+    /// Called with the coroutines that are handed the mutex, to resume them.
+    using Scheduler = std::function<void(std::coroutine_handle<>)>;
+
+    AsyncMutex() = default;
+    /**
+     * @brief Construct an AsyncMutex object whose waiting coroutines are resumed by a scheduler, for instance by posting
+     * them to a thread pool.
+     *
+     * @param scheduler Called with the coroutine handed the mutex, instead of resuming it on the unlocking thread.
+     */
+    explicit AsyncMutex(Scheduler scheduler) : m_scheduler(std::move(scheduler))
+    {
+    }
+    AsyncMutex(const AsyncMutex &) = delete;
+    AsyncMutex &operator=(const AsyncMutex &) = delete;
+
+    /**
+     * @brief Lock the mutex asynchronously: co_await mutex.lockAsync();
+     */
+    LockAwaiter lockAsync() noexcept
+    {
+        return LockAwaiter(*this);
+    }
+
+    void lock()
+    {
+        std::unique_lock<std::mutex> guard(m_guard);
+        ++m_blockedThreads;
+        m_unlocked.wait(guard, [this]() { return !m_locked || m_handedToThread; });
+        --m_blockedThreads;
+        // Either the mutex was handed over to this thread and stays locked, or it was unlocked.
+        m_handedToThread = false;
+        m_locked = true;
+    }
+
+    bool try_lock()
+    {
+        std::lock_guard<std::mutex> guard(m_guard);
+        if (m_locked)
+        {
+            return false;
+        }
+        m_locked = true;
+        return true;
+    }
+
+    /**
+     * @brief Unlock the mutex, or hand it over to a waiting coroutine or thread, which then owns it.
+     */
+    void unlock()
+    {
+        LockAwaiter *next = nullptr;
+        {
+            std::lock_guard<std::mutex> guard(m_guard);
+            if (m_head != nullptr && (m_blockedThreads == 0 || !m_handedToCoroutine))
+            {
+                // Hand the mutex over to the first coroutine: it stays locked.
+                next = m_head;
+                m_head = next->m_next;
+                if (m_head == nullptr)
+                {
+                    m_tail = nullptr;
+                }
+                m_handedToCoroutine = true;
+            }
+            else if (m_blockedThreads != 0)
+            {
+                // Hand the mutex over to a thread: it stays locked.
+                m_handedToThread = true;
+                m_handedToCoroutine = false;
+                m_unlocked.notify_one();
+            }
+            else
+            {
+                m_locked = false;
+            }
+        }
+        if (next != nullptr)
+        {
+            resume(*next);
+        }
+    }
+
+  private:
+    /**
+     * @brief Coroutines handed an AsyncMutex by the current thread, run one after the other rather than nested.
+     */
+    struct Trampoline
+    {
+        LockAwaiter *head = nullptr;
+        LockAwaiter *tail = nullptr;
+        bool running = false;
+    };
+
+    /**
+     * @brief Resume a coroutine that was handed the mutex, with the scheduler if there is one. Otherwise, on this
+     * thread, after the coroutine this thread runs for an AsyncMutex (if any) suspends or returns.
+     */
+    void resume(LockAwaiter &awaiter)
+    {
+        if (m_scheduler)
+        {
+            m_scheduler(awaiter.m_handle);
+            return;
+        }
+
+        static thread_local Trampoline trampoline;
+        awaiter.m_next = nullptr;
+        if (trampoline.tail == nullptr)
+        {
+            trampoline.head = &awaiter;
+        }
+        else
+        {
+            trampoline.tail->m_next = &awaiter;
+        }
+        trampoline.tail = &awaiter;
+        if (trampoline.running)
+        {
+            return;
+        }
+
+        trampoline.running = true;
+        struct Stop
+        {
+            Trampoline &trampoline;
+            ~Stop()
+            {
+                // Also if a coroutine throws: the next hand-off on this thread resumes the coroutines left.
+                trampoline.running = false;
+            }
+        } stop{trampoline};
+        while (trampoline.head != nullptr)
+        {
+            LockAwaiter *next = trampoline.head;
+            trampoline.head = next->m_next;
+            if (trampoline.head == nullptr)
+            {
+                trampoline.tail = nullptr;
+            }
+            // Read before resuming: the awaiter lives in the coroutine frame.
+            const std::coroutine_handle<> handle = next->m_handle;
+            handle.resume();
+        }
+    }
+
+    /**
+     * @brief Queue a coroutine, or lock the mutex if it was unlocked meanwhile.
+     *
+     * @return bool True if the coroutine must be suspended.
+     */
+    bool enqueue(LockAwaiter &awaiter)
+    {
+        std::lock_guard<std::mutex> guard(m_guard);
+        if (!m_locked)
+        {
+            m_locked = true;
+            return false;
+        }
+        if (m_tail == nullptr)
+        {
+            m_head = &awaiter;
+        }
+        else
+        {
+            m_tail->m_next = &awaiter;
+        }
+        m_tail = &awaiter;
+        return true;
+    }
+
+    /// Protects the state of the mutex, never held while a coroutine runs.
+    std::mutex m_guard;
+    std::condition_variable m_unlocked;
+    bool m_locked = false;
+    unsigned m_blockedThreads = 0;
+    /// Whether the mutex was handed over to a blocked thread that did not wake up yet.
+    bool m_handedToThread = false;
+    /// Whether the mutex was last handed over to a coroutine rather than to a thread.
+    bool m_handedToCoroutine = false;
+    Scheduler m_scheduler;
+    /// Queue of the suspended coroutines, first in first out.
+    LockAwaiter *m_head = nullptr;
+    LockAwaiter *m_tail = nullptr;
+};
+} // namespace safe
+#endif // __cplusplus >= 202002L
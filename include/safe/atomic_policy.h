@@ -0,0 +1,133 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "copying_safe.h"
+#include "safe.h"
+
+#include <atomic>
+#include <thread>
+#include <type_traits>
+
+namespace safe
+{
+/**
+ * @brief Use as the MutexType of a Safe object to store the value in a std::atomic: see the Safe<ValueType,
+ * AtomicPolicy> specialization. The policy itself is the spinlock that writers lock: it meets the Lockable requirements,
+ * so any lock type can manage it.
+ */
+class AtomicPolicy
+{
+  public:
+    AtomicPolicy() = default;
+    AtomicPolicy(const AtomicPolicy &) = delete;
+    AtomicPolicy &operator=(const AtomicPolicy &) = delete;
+
+    void lock() noexcept
+    {
+        while (!try_lock())
+        {
+            while (m_locked.load(std::memory_order_relaxed))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool try_lock() noexcept
+    {
+        return !m_locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock() noexcept
+    {
+        m_locked.store(false, std::memory_order_release);
+    }
+
+  private:
+    std::atomic<bool> m_locked{false};
+};
+
+namespace impl
+{
+/**
+ * @brief Storage for the value of a Safe<ValueType, AtomicPolicy> object: a std::atomic, loaded and stored in a single
+ * atomic operation.
+ *
+ * @tparam ValueType The type of the value, must be trivially copyable.
+ */
+template <typename ValueType> class AtomicStorage
+{
+  public:
+    explicit AtomicStorage(const ValueType &value) noexcept : m_value(value)
+    {
+    }
+
+    /**
+     * @brief Atomically load the value. Never blocks.
+     */
+    ValueType load(const AtomicPolicy &) const noexcept
+    {
+        return m_value.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Atomically load the value. Never fails.
+     */
+    bool tryLoad(const AtomicPolicy &policy, ValueType &value) const noexcept
+    {
+        value = load(policy);
+        return true;
+    }
+
+    /**
+     * @brief Load the value. Must be called with the writers' spinlock locked.
+     */
+    ValueType loadLocked() const noexcept
+    {
+        return m_value.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Atomically store a value. Must be called with the writers' spinlock locked.
+     */
+    void storeLocked(const ValueType &value) noexcept
+    {
+        m_value.store(value, std::memory_order_release);
+    }
+
+  private:
+    std::atomic<ValueType> m_value;
+};
+} // namespace impl
+
+/**
+ * @brief Specialization of Safe that stores the value in a std::atomic, for values like integers, pointers and small
+ * enums. Call sites are the same as with a mutex.
+ *
+ * Read accesses hold a copy of the value, obtained with a single atomic load: readers never lock anything. Write
+ * accesses lock the writers' spinlock, give access to a copy of the value and store it back atomically when destroyed.
+ * Writers exclude each other instead of retrying a compare-and-swap, because the code run between writeLock() and the
+ * destruction of the WriteAccess object cannot be replayed.
+ *
+ * @tparam ValueType The type of the value to protect, must be trivially copyable.
+ */
+template <typename ValueType>
+class Safe<ValueType, AtomicPolicy> : public impl::CopyingSafe<ValueType, AtomicPolicy, impl::AtomicStorage<ValueType>>
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value,
+                  "Safe<ValueType, AtomicPolicy> requires a trivially copyable ValueType.");
+#if __cplusplus >= 201703L
+    static_assert(std::atomic<ValueType>::is_always_lock_free,
+                  "Safe<ValueType, AtomicPolicy> requires a ValueType that is always lock free, consider SeqLock.");
+#endif // __cplusplus >= 201703L
+
+  public:
+    using impl::CopyingSafe<ValueType, AtomicPolicy, impl::AtomicStorage<ValueType>>::CopyingSafe;
+};
+} // namespace safe
@@ -0,0 +1,82 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "atomic_policy.h"
+#include "cache_line.h"
+#include "distributed_shared_mutex.h"
+#include "safe.h"
+#include "seqlock.h"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <type_traits>
+
+#if __cplusplus >= 201703L
+namespace safe
+{
+/// How a value is accessed, the hint safe::Auto uses to choose between exclusive and shared locking.
+enum class Workload
+{
+    /// Reads and writes in comparable numbers.
+    Mixed,
+    /// Many more reads than writes.
+    ReadMostly,
+    /// As many writes as reads, or more.
+    WriteHeavy
+};
+
+namespace impl
+{
+/// Largest value SeqLock readers copy: beyond a few cache lines, retried copies cost more than locking.
+constexpr std::size_t autoSeqLockMaxSize = 4 * cacheLineSize;
+
+/// Whether a std::atomic of the value type is lock free, without instantiating std::atomic for other types.
+template <typename ValueType, bool = std::is_trivially_copyable<ValueType>::value>
+struct IsLockFreeAtomic : std::false_type
+{
+};
+template <typename ValueType>
+struct IsLockFreeAtomic<ValueType, true> : std::integral_constant<bool, std::atomic<ValueType>::is_always_lock_free>
+{
+};
+
+template <typename ValueType, Workload Hint> struct AutoMutex
+{
+    using type = std::conditional_t<
+        // One atomic load per read, whatever the workload.
+        IsLockFreeAtomic<ValueType>::value, AtomicPolicy,
+        std::conditional_t<
+            // Readers copy the value and do not write to shared memory, but busy writers make them retry.
+            std::is_trivially_copyable<ValueType>::value && sizeof(ValueType) <= autoSeqLockMaxSize &&
+                Hint != Workload::WriteHeavy,
+            SeqLock,
+            // Readers cannot copy the value without locking: exclusive locking, unless reads dominate.
+            std::conditional_t<Hint == Workload::ReadMostly, DistributedSharedMutex, std::mutex>>>;
+};
+} // namespace impl
+
+/**
+ * @brief Safe object whose mutex type is chosen at compile time from the properties of the value type and a workload
+ * hint:
+ * - AtomicPolicy for trivially copyable values that fit in a lock-free std::atomic;
+ * - SeqLock for other trivially copyable values of up to four cache lines, unless writes dominate;
+ * - DistributedSharedMutex for other values that are mostly read;
+ * - std::mutex otherwise.
+ *
+ * All choices have the same readLock(), writeLock(), tryReadLock(), tryWriteLock(), apply(), load(), exchange(), take()
+ * and store() functions, but read accesses to atomic and seqlock values hold a copy of the value. Requires C++17.
+ *
+ * @tparam ValueType The type of the value to protect.
+ * @tparam Hint How the value is accessed.
+ */
+template <typename ValueType, Workload Hint = Workload::Mixed>
+using Auto = Safe<ValueType, typename impl::AutoMutex<ValueType, Hint>::type>;
+} // namespace safe
+#endif // __cplusplus >= 201703L
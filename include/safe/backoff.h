@@ -0,0 +1,106 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+namespace safe
+{
+namespace impl
+{
+/**
+ * @brief Tell the processor that the thread is spinning: saves power and lets the other hyper-thread run.
+ */
+inline void cpuRelax() noexcept
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_ia32_pause();
+#elif defined(__GNUC__) && defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+} // namespace impl
+
+/**
+ * @brief Bounded spin with exponential backoff, to pass to Safe::tryReadLock() and Safe::tryWriteLock(): the mutex is
+ * tried up to attempts times, the thread spins for twice as long after each failed attempt. The thread never sleeps.
+ */
+class Backoff
+{
+  public:
+    /**
+     * @brief Construct a Backoff object.
+     *
+     * @param attempts Maximum number of times to try to lock the mutex, at least one.
+     * @param maxPauses Maximum number of pauses between two attempts. The first wait is one pause long.
+     */
+    explicit Backoff(unsigned attempts, unsigned maxPauses = 64) noexcept
+        : m_attempts(attempts), m_maxPauses(maxPauses)
+    {
+    }
+
+    /**
+     * @brief Try to lock a lock object until it succeeds or the attempts are exhausted.
+     *
+     * @tparam LockType Deduced from lock, must have a try_lock() function.
+     * @param lock The lock object to lock.
+     * @return bool True if the lock was locked.
+     */
+    template <typename LockType> bool tryLock(LockType &lock) const
+    {
+        unsigned pauses = 1;
+        for (unsigned attempt = 1;; ++attempt)
+        {
+            if (lock.try_lock())
+            {
+                return true;
+            }
+            if (attempt >= m_attempts)
+            {
+                return false;
+            }
+            for (unsigned pause = 0; pause < pauses; ++pause)
+            {
+                impl::cpuRelax();
+            }
+            pauses = pauses * 2 < m_maxPauses ? pauses * 2 : m_maxPauses;
+        }
+    }
+
+  private:
+    unsigned m_attempts;
+    unsigned m_maxPauses;
+};
+
+namespace impl
+{
+// The ways to try to lock the lock object of a TryAccess object: once, with a Backoff object, for a duration or until
+// a time point. The lock object does not own the mutex if they fail.
+template <typename LockType> void tryLock(LockType &lock)
+{
+    lock.try_lock();
+}
+template <typename LockType> void tryLock(LockType &lock, const Backoff &backoff)
+{
+    backoff.tryLock(lock);
+}
+template <typename LockType, typename Rep, typename Period>
+void tryLock(LockType &lock, const std::chrono::duration<Rep, Period> &timeout)
+{
+    lock.try_lock_for(timeout);
+}
+template <typename LockType, typename Clock, typename Duration>
+void tryLock(LockType &lock, const std::chrono::time_point<Clock, Duration> &deadline)
+{
+    lock.try_lock_until(deadline);
+}
+} // namespace impl
+} // namespace safe
@@ -0,0 +1,59 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace safe
+{
+/**
+ * @brief Alignment that keeps objects modified by different threads on different cache lines.
+ *
+ * std::hardware_destructive_interference_size is not used because its value may differ between compilation units
+ * (compilers warn about using it in headers). 64 bytes is right for most x86 and ARM processors.
+ */
+constexpr std::size_t cacheLineSize = 64;
+
+/**
+ * @brief A mutex alone on its cache lines. Use it as the MutexType of a Safe object to keep the mutex and the value on
+ * different cache lines: threads that wait on the mutex do not disturb the thread that works on the value.
+ *
+ * @tparam MutexType The type of the mutex to pad.
+ */
+template <typename MutexType> struct alignas(cacheLineSize) PaddedMutex : MutexType
+{
+    using MutexType::MutexType;
+};
+
+/**
+ * @brief A Safe object (or any other type) aligned and padded to whole cache lines, so that it never shares a cache
+ * line with its neighbours, in an array or in a struct. The mutex and the value stay together, on the same cache line
+ * if they fit.
+ *
+ * Dynamically allocated objects are only guaranteed to be aligned since C++17.
+ *
+ * @tparam SafeType The type of the object to align.
+ */
+template <typename SafeType> struct alignas(cacheLineSize) Aligned : SafeType
+{
+    using SafeType::SafeType;
+};
+
+namespace impl
+{
+/**
+ * @brief Index of a slot among slotCount (mutexes, buckets...), chosen from a hash or an address with Fibonacci hashing:
+ * neighbouring addresses and small integer keys (which std::hash often leaves as they are) spread over all slots.
+ */
+constexpr std::size_t slotIndex(std::uint64_t hash, std::size_t slotCount) noexcept
+{
+    return static_cast<std::size_t>((hash * 0x9E3779B97F4A7C15ull) >> 32) % slotCount;
+}
+} // namespace impl
+} // namespace safe
@@ -0,0 +1,143 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace safe
+{
+/**
+ * @brief Mutex with flat combining: Safe::apply() hands its function over to the thread that holds the mutex instead
+ * of waiting for the mutex. The holder executes all pending functions in a batch before unlocking, so that the value
+ * stays in its cache.
+ *
+ * The mutex can also be locked normally, for instance through Safe::writeLock(). Normal lock holders do not execute
+ * pending functions.
+ */
+class CombiningMutex
+{
+  public:
+    void lock()
+    {
+        m_mutex.lock();
+    }
+    bool try_lock()
+    {
+        return m_mutex.try_lock();
+    }
+    void unlock()
+    {
+        m_mutex.unlock();
+    }
+
+    /**
+     * @brief Call function with the mutex locked, either on this thread or on the thread that holds the mutex.
+     * Exceptions thrown by function are rethrown on this thread.
+     *
+     * @tparam Function Deduced from function.
+     * @param function Function to call, without arguments.
+     */
+    template <typename Function> void combine(Function &function)
+    {
+        if (m_mutex.try_lock())
+        {
+            std::lock_guard<std::mutex> lock(m_mutex, std::adopt_lock);
+            function();
+            executePending();
+            return;
+        }
+
+        Request request(function);
+        Request *head = m_pending.load(std::memory_order_relaxed);
+        do
+        {
+            request.next = head;
+        } while (!m_pending.compare_exchange_weak(head, &request, std::memory_order_release, std::memory_order_relaxed));
+
+        while (!request.done.load(std::memory_order_acquire))
+        {
+            if (m_mutex.try_lock())
+            {
+                std::lock_guard<std::mutex> lock(m_mutex, std::adopt_lock);
+                executePending();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        if (request.exception)
+        {
+            std::rethrow_exception(request.exception);
+        }
+    }
+
+  private:
+    /**
+     * @brief A function waiting to be executed, published by the thread that waits for it.
+     */
+    struct Request
+    {
+        template <typename Function>
+        explicit Request(Function &function)
+            : call([](void *erased) { (*static_cast<Function *>(erased))(); }), function(&function)
+        {
+        }
+
+        void (*call)(void *);
+        void *function;
+        Request *next = nullptr;
+        std::exception_ptr exception;
+        std::atomic<bool> done{false};
+    };
+
+    /**
+     * @brief Execute the pending requests, oldest first. Must be called with the mutex locked.
+     */
+    void executePending()
+    {
+        if (m_pending.load(std::memory_order_relaxed) == nullptr)
+        {
+            return;
+        }
+        Request *reversed = m_pending.exchange(nullptr, std::memory_order_acquire);
+        Request *request = nullptr;
+        while (reversed != nullptr)
+        {
+            Request *next = reversed->next;
+            reversed->next = request;
+            request = reversed;
+            reversed = next;
+        }
+
+        while (request != nullptr)
+        {
+            // The request lives on the stack of its thread: it must not be touched once done.
+            Request *next = request->next;
+            try
+            {
+                request->call(request->function);
+            }
+            catch (...)
+            {
+                request->exception = std::current_exception();
+            }
+            request->done.store(true, std::memory_order_release);
+            request = next;
+        }
+    }
+
+    std::mutex m_mutex;
+    /// Stack of the pending requests, most recent first.
+    std::atomic<Request *> m_pending{nullptr};
+};
+} // namespace safe
@@ -0,0 +1,245 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "backoff.h"
+#include "cache_line.h"
+#include "default_locks.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // defined(__linux__)
+
+namespace safe
+{
+namespace impl
+{
+#if defined(__linux__)
+// Sleep until woken up, if the word still holds expected.
+inline void futexWait(std::atomic<std::uint32_t> &word, std::uint32_t expected) noexcept
+{
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+// Wake up one thread sleeping on the word.
+inline void futexWakeOne(std::atomic<std::uint32_t> &word) noexcept
+{
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+#elif __cplusplus >= 202002L
+inline void futexWait(std::atomic<std::uint32_t> &word, std::uint32_t expected) noexcept
+{
+    word.wait(expected, std::memory_order_relaxed);
+}
+inline void futexWakeOne(std::atomic<std::uint32_t> &word) noexcept
+{
+    word.notify_one();
+}
+#else
+// No way to sleep on a word: let other threads run.
+inline void futexWait(std::atomic<std::uint32_t> &, std::uint32_t) noexcept
+{
+    std::this_thread::yield();
+}
+inline void futexWakeOne(std::atomic<std::uint32_t> &) noexcept
+{
+}
+#endif // defined(__linux__)
+
+/**
+ * @brief Where ParkingMutex waiters sleep: a fixed table of buckets shared by all ParkingMutex objects, selected by
+ * hashing the address of the mutex.
+ */
+struct alignas(cacheLineSize) ParkingBucket
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    static ParkingBucket &of(const void *address) noexcept
+    {
+        static ParkingBucket buckets[256];
+        return buckets[slotIndex(reinterpret_cast<std::uintptr_t>(address), 256)];
+    }
+};
+} // namespace impl
+
+/**
+ * @brief Mutex that takes 4 bytes: threads that wait for it sleep on the mutex itself, using a futex on Linux (C++20
+ * atomic waits elsewhere, or yielding before C++20).
+ *
+ * The mutex is unlocked (0), locked (1) or locked with possible waiters (2): unlocking only makes a system call when
+ * there may be waiters.
+ */
+class FutexMutex
+{
+  public:
+    FutexMutex() = default;
+    FutexMutex(const FutexMutex &) = delete;
+    FutexMutex &operator=(const FutexMutex &) = delete;
+
+    void lock() noexcept
+    {
+        std::uint32_t state = unlocked;
+        if (m_state.compare_exchange_strong(state, locked, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            return;
+        }
+        if (state != contended)
+        {
+            state = m_state.exchange(contended, std::memory_order_acquire);
+        }
+        while (state != unlocked)
+        {
+            impl::futexWait(m_state, contended);
+            state = m_state.exchange(contended, std::memory_order_acquire);
+        }
+    }
+
+    bool try_lock() noexcept
+    {
+        std::uint32_t state = unlocked;
+        return m_state.compare_exchange_strong(state, locked, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock() noexcept
+    {
+        if (m_state.exchange(unlocked, std::memory_order_release) == contended)
+        {
+            impl::futexWakeOne(m_state);
+        }
+    }
+
+  private:
+    static constexpr std::uint32_t unlocked = 0;
+    static constexpr std::uint32_t locked = 1;
+    static constexpr std::uint32_t contended = 2;
+
+    std::atomic<std::uint32_t> m_state{unlocked};
+};
+
+/**
+ * @brief Mutex that takes 1 byte: threads that wait for it spin for a short while, then sleep in a global table of
+ * condition variables, selected by the address of the mutex.
+ *
+ * One bit tells whether the mutex is locked, another one whether threads may be sleeping: unlocking only touches the
+ * global table when there may be sleeping threads.
+ */
+class ParkingMutex
+{
+  public:
+    ParkingMutex() = default;
+    ParkingMutex(const ParkingMutex &) = delete;
+    ParkingMutex &operator=(const ParkingMutex &) = delete;
+
+    void lock()
+    {
+        std::uint8_t state = 0;
+        if (!m_state.compare_exchange_weak(state, lockedBit, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            lockSlow();
+        }
+    }
+
+    bool try_lock() noexcept
+    {
+        std::uint8_t state = m_state.load(std::memory_order_relaxed);
+        while ((state & lockedBit) == 0)
+        {
+            if (m_state.compare_exchange_weak(state, static_cast<std::uint8_t>(state | lockedBit),
+                                              std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void unlock()
+    {
+        if ((m_state.exchange(0, std::memory_order_release) & parkedBit) != 0)
+        {
+            impl::ParkingBucket &bucket = impl::ParkingBucket::of(this);
+            // Locking the bucket's mutex makes sure that the sleeping threads are waiting on the condition variable.
+            std::lock_guard<std::mutex> lock(bucket.mutex);
+            bucket.condition.notify_all();
+        }
+    }
+
+  private:
+    void lockSlow()
+    {
+        for (unsigned spin = 0; spin < spinCount; ++spin)
+        {
+            if (try_lock())
+            {
+                return;
+            }
+            impl::cpuRelax();
+        }
+
+        impl::ParkingBucket &bucket = impl::ParkingBucket::of(this);
+        std::unique_lock<std::mutex> lock(bucket.mutex);
+        std::uint8_t state = m_state.load(std::memory_order_relaxed);
+        while (true)
+        {
+            if ((state & lockedBit) == 0)
+            {
+                // Other threads may still be sleeping: keep the parked bit.
+                if (m_state.compare_exchange_weak(state, static_cast<std::uint8_t>(lockedBit | parkedBit),
+                                                  std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    return;
+                }
+            }
+            else if ((state & parkedBit) == 0)
+            {
+                const std::uint8_t parked = static_cast<std::uint8_t>(state | parkedBit);
+                if (m_state.compare_exchange_weak(state, parked, std::memory_order_relaxed))
+                {
+                    state = parked;
+                }
+            }
+            else
+            {
+                bucket.condition.wait(lock);
+                state = m_state.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static constexpr unsigned spinCount = 64;
+    static constexpr std::uint8_t lockedBit = 1;
+    static constexpr std::uint8_t parkedBit = 2;
+
+    std::atomic<std::uint8_t> m_state{0};
+};
+
+namespace impl
+{
+// The compact mutexes only have exclusive locking: always default to std::lock_guard, even if the default locks are
+// overridden for all mutex types.
+template <> struct DefaultLocks<FutexMutex>
+{
+    using ReadOnly = std::lock_guard<FutexMutex>;
+    using ReadWrite = std::lock_guard<FutexMutex>;
+};
+template <> struct DefaultLocks<ParkingMutex>
+{
+    using ReadOnly = std::lock_guard<ParkingMutex>;
+    using ReadWrite = std::lock_guard<ParkingMutex>;
+};
+} // namespace impl
+} // namespace safe
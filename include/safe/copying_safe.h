@@ -0,0 +1,548 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "safe.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 201703L
+#define EXPLICIT_IF_CPP17 explicit
+#define EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17 ReturnType
+#else
+#define EXPLICIT_IF_CPP17
+#define EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17
+#endif
+
+namespace safe
+{
+namespace impl
+{
+/**
+ * @brief Common implementation of the Safe specializations whose readers copy the value without locking anything
+ * (Safe<ValueType, AtomicPolicy> and Safe<ValueType, SeqLock>). Read accesses hold a copy of the value. Write accesses
+ * lock the mutex, give access to a copy of the value and store it back when destroyed.
+ *
+ * The storage decides how the value is copied. It is constructed from a value and has these member functions:
+ * - ValueType load(const MutexType &mutex) const: a consistent copy, taken without locking the mutex;
+ * - bool tryLoad(const MutexType &mutex, ValueType &value) const: the same, but gives up instead of waiting for
+ *   writers;
+ * - ValueType loadLocked() const: a copy, taken with the mutex locked;
+ * - void storeLocked(const ValueType &value): replace the value, with the mutex locked.
+ *
+ * @tparam ValueType The type of the value to protect, must be trivially copyable.
+ * @tparam MutexType The type of the mutex that writers lock.
+ * @tparam StorageType The type of the storage of the value.
+ */
+template <typename ValueType, typename MutexType, typename StorageType> class CopyingSafe
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value, "CopyingSafe requires a trivially copyable ValueType.");
+
+  private:
+    /**
+     * @brief Read-only access to a consistent copy of the value.
+     */
+    class Snapshot
+    {
+      public:
+        /// Pointer-to-const ValueType
+        using ConstPointerType = const ValueType *;
+        /// Reference-to-const ValueType
+        using ConstReferenceType = const ValueType &;
+
+        /**
+         * @brief Construct a Snapshot object by copying the value out of a Safe object.
+         *
+         * @param safe The Safe object to copy the value from.
+         */
+        EXPLICIT_IF_CPP17 Snapshot(const CopyingSafe &safe) : m_value(safe.load())
+        {
+        }
+
+        /**
+         * @brief Const accessor to the copy of the value.
+         * @return ConstPointerType Const pointer to the copy.
+         */
+        ConstPointerType operator->() const noexcept
+        {
+            return &m_value;
+        }
+
+        /**
+         * @brief Const accessor to the copy of the value.
+         * @return ConstReferenceType Const reference to the copy.
+         */
+        ConstReferenceType operator*() const noexcept
+        {
+            return m_value;
+        }
+
+      private:
+        /// The copy of the value.
+        const ValueType m_value;
+    };
+
+    /**
+     * @brief Read-only access to a consistent copy of the value, if one could be taken without waiting for writers:
+     * convert it to bool before dereferencing it, like a TryAccess object of the general Safe template.
+     */
+    class TrySnapshot
+    {
+      public:
+        /// Pointer-to-const ValueType
+        using ConstPointerType = const ValueType *;
+        /// Reference-to-const ValueType
+        using ConstReferenceType = const ValueType &;
+
+        /**
+         * @brief Construct a TrySnapshot object that holds no copy yet.
+         *
+         * @param safe The Safe object to copy the value from.
+         */
+        explicit TrySnapshot(const CopyingSafe &safe) noexcept
+            : m_safe(safe), m_value(safe.m_storage.loadLocked()), m_loaded(false)
+        {
+        }
+
+        /**
+         * @brief Try once to copy the value, without waiting for writers.
+         * @return bool Whether the copy was taken.
+         */
+        bool try_lock() noexcept
+        {
+            m_loaded = m_safe.m_storage.tryLoad(m_safe.m_mutex, m_value);
+            return m_loaded;
+        }
+
+        /**
+         * @brief Try to copy the value until it succeeds or the timeout expires.
+         * @return bool Whether the copy was taken.
+         */
+        template <typename Rep, typename Period> bool try_lock_for(const std::chrono::duration<Rep, Period> &timeout)
+        {
+            return try_lock_until(std::chrono::steady_clock::now() + timeout);
+        }
+
+        /**
+         * @brief Try to copy the value until it succeeds or the deadline passes.
+         * @return bool Whether the copy was taken.
+         */
+        template <typename Clock, typename Duration>
+        bool try_lock_until(const std::chrono::time_point<Clock, Duration> &deadline)
+        {
+            while (!try_lock())
+            {
+                if (Clock::now() >= deadline)
+                {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            return true;
+        }
+
+        /**
+         * @brief Whether the copy was taken, and the TrySnapshot object can be dereferenced.
+         */
+        explicit operator bool() const noexcept
+        {
+            return m_loaded;
+        }
+
+        /**
+         * @brief Const accessor to the copy of the value.
+         * @return ConstPointerType Const pointer to the copy.
+         */
+        ConstPointerType operator->() const noexcept
+        {
+            assert(*this);
+            return &m_value;
+        }
+
+        /**
+         * @brief Const accessor to the copy of the value.
+         * @return ConstReferenceType Const reference to the copy.
+         */
+        ConstReferenceType operator*() const noexcept
+        {
+            assert(*this);
+            return m_value;
+        }
+
+      private:
+        /// The Safe object to copy the value from.
+        const CopyingSafe &m_safe;
+        /// The copy of the value, meaningless until it is taken.
+        ValueType m_value;
+        /// Whether the copy was taken.
+        bool m_loaded;
+    };
+
+    /**
+     * @brief Locks the mutex and gives pointer-like access to a copy of the value. The copy is stored back when the
+     * Access object is destroyed.
+     *
+     * @tparam LockType The type of the lock object that manages the mutex, example: std::lock_guard.
+     */
+    template <template <typename> class LockType> class Access
+    {
+        static_assert(!AccessTraits<LockType<MutexType>>::IsReadOnly,
+                      "Cannot have ReadWrite access mode with ReadOnly lock. "
+                      "Check the value of "
+                      "AccessTraits<LockType>::IsReadOnly if it exists.");
+
+      public:
+        /// Pointer-to-const ValueType
+        using ConstPointerType = const ValueType *;
+        /// Pointer to ValueType.
+        using PointerType = ValueType *;
+        /// Reference-to-const ValueType
+        using ConstReferenceType = const ValueType &;
+        /// Reference to ValueType.
+        using ReferenceType = ValueType &;
+
+        /**
+         * @brief Construct an Access object from a Safe object and any additionnal argument needed to construct the
+         * Lock object.
+         *
+         * @tparam OtherLockArgs Deduced from otherLockArgs.
+         * @param safe The Safe object to give protected access to.
+         * @param otherLockArgs Other arguments needed to construct the lock object.
+         */
+        template <typename... OtherLockArgs>
+        EXPLICIT_IF_CPP17 Access(CopyingSafe &safe, OtherLockArgs &&...otherLockArgs)
+            : lock(safe.m_mutex, std::forward<OtherLockArgs>(otherLockArgs)...), m_safe(safe),
+              m_copy(safe.m_storage.loadLocked()), m_loaded(impl::ownsLock(lock, 0))
+        {
+        }
+
+        Access(Access &&) = default;
+
+        /**
+         * @brief Store the copy back, if the lock is owned and the copy was taken with the lock owned.
+         */
+        ~Access()
+        {
+            if (m_loaded && impl::ownsLock(lock, 0))
+            {
+                m_safe.m_storage.storeLocked(m_copy);
+            }
+        }
+
+        /**
+         * @brief Const accessor to the copy.
+         * @return ConstPointerType Const pointer to the copy.
+         */
+        ConstPointerType operator->() const noexcept
+        {
+            return &copy();
+        }
+
+        /**
+         * @brief Accessor to the copy.
+         * @return PointerType Pointer to the copy.
+         */
+        PointerType operator->() noexcept
+        {
+            return &copy();
+        }
+
+        /**
+         * @brief Const accessor to the copy.
+         * @return ConstReferenceType Const reference to the copy.
+         */
+        ConstReferenceType operator*() const noexcept
+        {
+            return copy();
+        }
+
+        /**
+         * @brief Accessor to the copy.
+         * @return ReferenceType Reference to the copy.
+         */
+        ReferenceType operator*() noexcept
+        {
+            return copy();
+        }
+
+        /// The lock that manages the mutex.
+        mutable LockType<MutexType> lock;
+
+      private:
+        /**
+         * @brief The copy, taken again if the lock did not own the mutex when the Access object was constructed (like
+         * with std::defer_lock, as in lockAll()): writes committed before the lock was acquired are not lost.
+         */
+        ValueType &copy() const noexcept
+        {
+            if (!m_loaded && impl::ownsLock(lock, 0))
+            {
+                m_copy = m_safe.m_storage.loadLocked();
+                m_loaded = true;
+            }
+            return m_copy;
+        }
+
+        /// The Safe object to store the copy to.
+        CopyingSafe &m_safe;
+        /// The copy of the value, mutable because it is taken lazily by const accessors.
+        mutable ValueType m_copy;
+        /// Whether the copy was taken with the mutex owned.
+        mutable bool m_loaded;
+    };
+
+    /**
+     * @brief Access object whose lock may not own the mutex: convert it to bool before dereferencing it, like a
+     * TryAccess object of the general Safe template.
+     *
+     * @tparam LockType The type of the lock object that manages the mutex, must be able to try to lock it.
+     */
+    template <template <typename> class LockType> class TryAccess : public Access<LockType>
+    {
+        using Base = Access<LockType>;
+
+      public:
+        using Base::Base;
+
+        /**
+         * @brief Whether the lock owns the mutex, and the TryAccess object can be dereferenced.
+         */
+        explicit operator bool() const noexcept
+        {
+            return this->lock.owns_lock();
+        }
+
+        typename Base::ConstPointerType operator->() const noexcept
+        {
+            assert(*this);
+            return Base::operator->();
+        }
+        typename Base::PointerType operator->() noexcept
+        {
+            assert(*this);
+            return Base::operator->();
+        }
+        typename Base::ConstReferenceType operator*() const noexcept
+        {
+            assert(*this);
+            return Base::operator*();
+        }
+        typename Base::ReferenceType operator*() noexcept
+        {
+            assert(*this);
+            return Base::operator*();
+        }
+    };
+
+    struct LastArgumentIsATag
+    {
+    };
+
+  public:
+    /// Aliases to ReadAccess and WriteAccess classes for this Safe class. Read accesses are copies, they ignore the
+    /// LockType parameter.
+    template <template <typename> class LockType = DefaultReadOnlyLockType> using ReadAccess = Snapshot;
+    template <template <typename> class LockType = DefaultReadWriteLockType> using WriteAccess = Access<LockType>;
+    /// Aliases to TryReadAccess and TryWriteAccess classes for this Safe class. Try read accesses ignore the LockType
+    /// parameter too.
+    template <template <typename> class LockType = DefaultTryReadOnlyLockType> using TryReadAccess = TrySnapshot;
+    template <template <typename> class LockType = DefaultTryReadWriteLockType>
+    using TryWriteAccess = TryAccess<LockType>;
+
+    /**
+     * @brief Construct a Safe object, forwarding all arguments to construct the value object.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the value object.
+     */
+    template <typename... Args,
+              typename std::enable_if<!std::is_same<const impl::DefaultConstructMutex &, safe::Last<Args...>>::value,
+                                      bool>::type = true>
+    explicit CopyingSafe(Args &&...args) : m_mutex(), m_storage(ValueType(std::forward<Args>(args)...))
+    {
+    }
+    /**
+     * @brief Construct a Safe object, forwarding all arguments but the last (the default_construct_mutex tag) to
+     * construct the value object, like the general Safe template.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the value object, followed by the default_construct_mutex
+     * tag.
+     */
+    template <typename... Args,
+              typename std::enable_if<std::is_same<const impl::DefaultConstructMutex &, safe::Last<Args...>>::value,
+                                      bool>::type = true>
+    explicit CopyingSafe(Args &&...args)
+        : CopyingSafe(LastArgumentIsATag(), std::forward_as_tuple(std::forward<Args>(args)...),
+                      safe::impl::make_index_sequence<sizeof...(args) - 1>())
+    {
+    }
+
+    /// Delete all copy/move construction/assignment, as these operations require locking the mutex under the covers.
+    CopyingSafe(const CopyingSafe &) = delete;
+    CopyingSafe(CopyingSafe &&) = delete;
+    CopyingSafe &operator=(const CopyingSafe &) = delete;
+    CopyingSafe &operator=(CopyingSafe &&) = delete;
+
+    /**
+     * @brief Copy the value out of the Safe object to get a ReadAccess object. Never blocks writers.
+     */
+    template <template <typename> class LockType = DefaultReadOnlyLockType> ReadAccess<LockType> readLock() const
+    {
+        return ReadAccess<LockType>(*this);
+    }
+
+    /**
+     * @brief Lock the Safe object to get a WriteAccess object.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the lock object.
+     */
+    template <template <typename> class LockType = DefaultReadWriteLockType, typename... LockArgs>
+    WriteAccess<LockType> writeLock(LockArgs &&...lockArgs)
+    {
+        using ReturnType = WriteAccess<LockType>;
+        return EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17{*this, std::forward<LockArgs>(lockArgs)...};
+    }
+
+    /**
+     * @brief Try to copy the value out of the Safe object to get a TryReadAccess object, without waiting for writers:
+     * convert it to bool to know whether the copy was taken. Takes the same arguments as Safe::tryReadLock().
+     *
+     * @tparam TryArgs Deduced from tryArgs.
+     * @param tryArgs Nothing, a safe::Backoff object, a std::chrono::duration or a std::chrono::time_point.
+     */
+    template <template <typename> class LockType = DefaultTryReadOnlyLockType, typename... TryArgs>
+    TryReadAccess<LockType> tryReadLock(const TryArgs &...tryArgs) const
+    {
+        TryReadAccess<LockType> access(*this);
+        impl::tryLock(access, tryArgs...);
+        return access;
+    }
+
+    /**
+     * @brief Try to lock the Safe object to get a TryWriteAccess object, without blocking: convert it to bool to know
+     * whether the mutex was locked. Takes the same arguments as Safe::tryWriteLock().
+     *
+     * @tparam TryArgs Deduced from tryArgs.
+     * @param tryArgs Nothing, a safe::Backoff object, a std::chrono::duration or a std::chrono::time_point.
+     */
+    template <template <typename> class LockType = DefaultTryReadWriteLockType, typename... TryArgs>
+    TryWriteAccess<LockType> tryWriteLock(const TryArgs &...tryArgs)
+    {
+        TryWriteAccess<LockType> access(*this, std::defer_lock);
+        impl::tryLock(access.lock, tryArgs...);
+        return access;
+    }
+
+    /**
+     * @brief Call a function with a const reference to a copy of the value. Never blocks writers.
+     *
+     * @tparam Function Deduced from function.
+     * @param function Function called with a const ValueType & argument.
+     */
+    template <typename Function> void apply(Function &&function) const
+    {
+        const ValueType value(load());
+        function(value);
+    }
+    /**
+     * @brief Call a function with a reference to a copy of the value, the mutex being locked with the default
+     * read-write lock type. The copy is stored back when the function returns.
+     *
+     * @tparam Function Deduced from function.
+     * @param function Function called with a ValueType & argument.
+     */
+    template <typename Function> void apply(Function &&function)
+    {
+        WriteAccess<> access(*this);
+        function(*access);
+    }
+
+    /**
+     * @brief Copy the value out of the Safe object. Never blocks writers.
+     *
+     * @return ValueType A consistent copy of the value.
+     */
+    ValueType load() const noexcept
+    {
+        return m_storage.load(m_mutex);
+    }
+
+    /**
+     * @brief Replace the value and return the old one.
+     *
+     * @tparam NewValue Deduced from newValue.
+     * @param newValue Perfect forwarding argument to construct the new value.
+     * @return ValueType The old value.
+     */
+    template <typename NewValue> ValueType exchange(NewValue &&newValue)
+    {
+        const ValueType value(std::forward<NewValue>(newValue));
+        WriteAccess<> access(*this);
+        const ValueType old(*access);
+        *access = value;
+        return old;
+    }
+
+    /**
+     * @brief Copy the value out of the Safe object, leaving a value-initialized value in its place.
+     *
+     * @return ValueType The value.
+     */
+    ValueType take()
+    {
+        return exchange(ValueType());
+    }
+
+    /**
+     * @brief Replace the value.
+     *
+     * @tparam NewValue Deduced from newValue.
+     * @param newValue Perfect forwarding argument to construct the new value.
+     */
+    template <typename NewValue> void store(NewValue &&newValue)
+    {
+        const ValueType value(std::forward<NewValue>(newValue));
+        WriteAccess<> access(*this);
+        *access = value;
+    }
+
+    /**
+     * @brief Accessor to the mutex.
+     *
+     * @return MutexType& Reference to the mutex.
+     */
+    MutexType &mutex() const noexcept
+    {
+        return m_mutex;
+    }
+
+  private:
+    template <typename ArgsTuple, size_t... AllButLast>
+    explicit CopyingSafe(const LastArgumentIsATag, ArgsTuple &&args, safe::impl::index_sequence<AllButLast...>)
+        : m_mutex(), m_storage(ValueType(std::get<AllButLast>(std::forward<ArgsTuple>(args))...))
+    {
+    }
+
+    /// The mutex that writers lock, mutable because mutex() is const like in the general Safe template.
+    mutable MutexType m_mutex;
+    /// The value to protect.
+    StorageType m_storage;
+};
+} // namespace impl
+} // namespace safe
+
+#undef EXPLICIT_IF_CPP17
+#undef EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17
@@ -0,0 +1,312 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "safe.h"
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 201703L
+#define EXPLICIT_IF_CPP17 explicit
+#define EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17 ReturnType
+#else
+#define EXPLICIT_IF_CPP17
+#define EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17
+#endif
+
+namespace safe
+{
+namespace impl
+{
+#if defined(__cpp_lib_atomic_shared_ptr)
+/**
+ * @brief A shared_ptr that can be loaded and stored concurrently.
+ */
+template <typename Type> class AtomicSharedPtr
+{
+  public:
+    explicit AtomicSharedPtr(std::shared_ptr<Type> pointer) : m_pointer(std::move(pointer))
+    {
+    }
+    std::shared_ptr<Type> load() const noexcept
+    {
+        return m_pointer.load(std::memory_order_acquire);
+    }
+    void store(std::shared_ptr<Type> pointer) noexcept
+    {
+        m_pointer.store(std::move(pointer), std::memory_order_release);
+    }
+
+  private:
+    std::atomic<std::shared_ptr<Type>> m_pointer;
+};
+#else
+/**
+ * @brief A shared_ptr that can be loaded and stored concurrently.
+ */
+template <typename Type> class AtomicSharedPtr
+{
+  public:
+    explicit AtomicSharedPtr(std::shared_ptr<Type> pointer) : m_pointer(std::move(pointer))
+    {
+    }
+    std::shared_ptr<Type> load() const noexcept
+    {
+        return std::atomic_load_explicit(&m_pointer, std::memory_order_acquire);
+    }
+    void store(std::shared_ptr<Type> pointer) noexcept
+    {
+        std::atomic_store_explicit(&m_pointer, std::move(pointer), std::memory_order_release);
+    }
+
+  private:
+    std::shared_ptr<Type> m_pointer;
+};
+#endif // defined(__cpp_lib_atomic_shared_ptr)
+} // namespace impl
+
+/**
+ * @brief Copy-on-write alternative to Safe for large values that are read much more often than they are written.
+ *
+ * Readers get a reference-counted handle to an immutable snapshot of the value: they never lock the writers' mutex, and
+ * never wait for a writer's critical section. Loading the handle is an atomic shared_ptr copy, which is not lock-free:
+ * the standard library protects it with an internal lock held for a few instructions (before C++20, libstdc++ uses a
+ * global pool of mutexes shared by all shared_ptr objects). Writers lock a mutex (writers exclude each other), work on
+ * a private copy of the value and publish it when the WriteAccess object is destroyed. Old snapshots are freed by
+ * whoever holds the last handle to them.
+ *
+ * @tparam ValueType The type of the value to protect, must be copy constructible.
+ * @tparam MutexType The type of the mutex that writers lock.
+ */
+template <typename ValueType, typename MutexType = std::mutex> class CowSafe
+{
+  private:
+    /**
+     * @brief Read-only access to an immutable snapshot of the value.
+     */
+    class Snapshot
+    {
+      public:
+        /// Pointer-to-const ValueType
+        using ConstPointerType = const ValueType *;
+        /// Reference-to-const ValueType
+        using ConstReferenceType = const ValueType &;
+
+        /**
+         * @brief Construct a Snapshot object holding the latest published value of a CowSafe object.
+         *
+         * @param safe The CowSafe object to give read-only access to.
+         */
+        EXPLICIT_IF_CPP17 Snapshot(const CowSafe &safe) : m_value(safe.m_value.load())
+        {
+        }
+
+        /**
+         * @brief Const accessor to the snapshot.
+         * @return ConstPointerType Const pointer to the snapshot.
+         */
+        ConstPointerType operator->() const noexcept
+        {
+            return m_value.get();
+        }
+
+        /**
+         * @brief Const accessor to the snapshot.
+         * @return ConstReferenceType Const reference to the snapshot.
+         */
+        ConstReferenceType operator*() const noexcept
+        {
+            return *m_value;
+        }
+
+      private:
+        /// Handle that keeps the snapshot alive.
+        std::shared_ptr<const ValueType> m_value;
+    };
+
+    /**
+     * @brief Locks the writers' mutex and gives pointer-like access to a private copy of the value. The copy is
+     * published when the Access object is destroyed.
+     *
+     * @tparam LockType The type of the lock object that manages the mutex, example: std::lock_guard.
+     */
+    template <template <typename> class LockType> class Access
+    {
+        static_assert(!AccessTraits<LockType<MutexType>>::IsReadOnly,
+                      "Cannot have ReadWrite access mode with ReadOnly lock. "
+                      "Check the value of "
+                      "AccessTraits<LockType>::IsReadOnly if it exists.");
+
+      public:
+        /// Pointer-to-const ValueType
+        using ConstPointerType = const ValueType *;
+        /// Pointer to ValueType.
+        using PointerType = ValueType *;
+        /// Reference-to-const ValueType
+        using ConstReferenceType = const ValueType &;
+        /// Reference to ValueType.
+        using ReferenceType = ValueType &;
+
+        /**
+         * @brief Construct an Access object from a CowSafe object and any additionnal argument needed to construct
+         * the Lock object.
+         *
+         * @tparam OtherLockArgs Deduced from otherLockArgs.
+         * @param safe The CowSafe object to give protected access to.
+         * @param otherLockArgs Other arguments needed to construct the lock object.
+         */
+        template <typename... OtherLockArgs>
+        EXPLICIT_IF_CPP17 Access(CowSafe &safe, OtherLockArgs &&...otherLockArgs)
+            : lock(safe.m_mutex, std::forward<OtherLockArgs>(otherLockArgs)...), m_safe(safe),
+              m_copy(impl::ownsLock(lock, 0) ? std::make_shared<ValueType>(*safe.m_value.load()) : nullptr)
+        {
+        }
+
+        Access(Access &&) = default;
+
+        /**
+         * @brief Publish the copy of the value, if the lock is owned.
+         */
+        ~Access()
+        {
+            if (m_copy && impl::ownsLock(lock, 0))
+            {
+                m_safe.m_value.store(std::move(m_copy));
+            }
+        }
+
+        /**
+         * @brief Const accessor to the copy.
+         * @return ConstPointerType Const pointer to the copy.
+         */
+        ConstPointerType operator->() const
+        {
+            return &copy();
+        }
+
+        /**
+         * @brief Accessor to the copy.
+         * @return PointerType Pointer to the copy.
+         */
+        PointerType operator->()
+        {
+            return &copy();
+        }
+
+        /**
+         * @brief Const accessor to the copy.
+         * @return ConstReferenceType Const reference to the copy.
+         */
+        ConstReferenceType operator*() const
+        {
+            return copy();
+        }
+
+        /**
+         * @brief Accessor to the copy.
+         * @return ReferenceType Reference to the copy.
+         */
+        ReferenceType operator*()
+        {
+            return copy();
+        }
+
+        /// The lock that manages the writers' mutex.
+        mutable LockType<MutexType> lock;
+
+      private:
+        /**
+         * @brief The private copy, made on first access if the lock did not own the mutex when the Access object was
+         * constructed (like with std::defer_lock, as in lockAll()). The lock must own the mutex.
+         */
+        ValueType &copy() const
+        {
+            if (!m_copy)
+            {
+                assert(impl::ownsLock(lock, 0));
+                m_copy = std::make_shared<ValueType>(*m_safe.m_value.load());
+            }
+            return *m_copy;
+        }
+
+        /// The CowSafe object to publish the copy to.
+        CowSafe &m_safe;
+        /// The private copy of the value, mutable because it is made lazily by const accessors.
+        mutable std::shared_ptr<ValueType> m_copy;
+    };
+
+  public:
+    /// Aliases to ReadAccess and WriteAccess classes for this CowSafe class. Read accesses never lock the mutex, they
+    /// ignore the LockType parameter.
+    template <template <typename> class LockType = DefaultReadOnlyLockType> using ReadAccess = Snapshot;
+    template <template <typename> class LockType = DefaultReadWriteLockType> using WriteAccess = Access<LockType>;
+
+    /**
+     * @brief Construct a CowSafe object, forwarding all arguments to construct the value object.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the value object.
+     */
+    template <typename... Args>
+    explicit CowSafe(Args &&...args)
+        : m_mutex(), m_value(std::make_shared<const ValueType>(std::forward<Args>(args)...))
+    {
+    }
+
+    /// Delete all copy/move construction/assignment, as these operations require locking the mutex under the covers.
+    CowSafe(const CowSafe &) = delete;
+    CowSafe(CowSafe &&) = delete;
+    CowSafe &operator=(const CowSafe &) = delete;
+    CowSafe &operator=(CowSafe &&) = delete;
+
+    /**
+     * @brief Get a ReadAccess object to the latest published snapshot. Never blocks, and is never blocked by writers.
+     */
+    template <template <typename> class LockType = DefaultReadOnlyLockType> ReadAccess<LockType> readLock() const
+    {
+        return ReadAccess<LockType>(*this);
+    }
+
+    /**
+     * @brief Lock the writers' mutex to get a WriteAccess object to a private copy of the value.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the lock object.
+     */
+    template <template <typename> class LockType = DefaultReadWriteLockType, typename... LockArgs>
+    WriteAccess<LockType> writeLock(LockArgs &&...lockArgs)
+    {
+        using ReturnType = WriteAccess<LockType>;
+        return EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17{*this, std::forward<LockArgs>(lockArgs)...};
+    }
+
+    /**
+     * @brief Accessor to the writers' mutex.
+     *
+     * @return MutexType& Reference to the mutex.
+     */
+    MutexType &mutex() const noexcept
+    {
+        return m_mutex;
+    }
+
+  private:
+    /// The mutex that writers lock.
+    mutable MutexType m_mutex;
+    /// The latest published snapshot of the value.
+    impl::AtomicSharedPtr<const ValueType> m_value;
+};
+} // namespace safe
+
+#undef EXPLICIT_IF_CPP17
+#undef EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17
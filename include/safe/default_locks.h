@@ -24,10 +24,31 @@ struct DefaultLocks
     using ReadOnly = std::lock_guard<MutexType>;
     using ReadWrite = std::lock_guard<MutexType>;
 };
+
+// Lock type used to try to lock a mutex, given the default lock type: the same lock template, unless it cannot try to
+// lock (std::lock_guard), in which case std::unique_lock.
+template<typename LockType>
+struct TryLocks;
+template<template<typename> class LockType, typename MutexType>
+struct TryLocks<LockType<MutexType>>
+{
+    template<typename OtherMutexType>
+    using Type = LockType<OtherMutexType>;
+};
+template<typename MutexType>
+struct TryLocks<std::lock_guard<MutexType>>
+{
+    template<typename OtherMutexType>
+    using Type = std::unique_lock<OtherMutexType>;
+};
 } // namespace impl
 
 template<typename MutexType>
 using DefaultReadOnlyLockType = typename impl::DefaultLocks<MutexType>::ReadOnly;
 template<typename MutexType>
 using DefaultReadWriteLockType = typename impl::DefaultLocks<MutexType>::ReadWrite;
+template<typename MutexType>
+using DefaultTryReadOnlyLockType = typename impl::TryLocks<DefaultReadOnlyLockType<MutexType>>::template Type<MutexType>;
+template<typename MutexType>
+using DefaultTryReadWriteLockType = typename impl::TryLocks<DefaultReadWriteLockType<MutexType>>::template Type<MutexType>;
 } // namespace safe
\ No newline at end of file
@@ -0,0 +1,154 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "cache_line.h"
+#include "default_locks.h"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#if __cplusplus >= 201402L
+#include <shared_mutex>
+#endif // __cplusplus >= 201402L
+
+namespace safe
+{
+/**
+ * @brief Reader-writer mutex whose readers do not share any counter: each thread counts its shared locks in its own
+ * slot, on its own cache line. Shared locking costs about as much as with std::shared_mutex on one core, but readers do
+ * not slow each other down as the number of cores grows.
+ *
+ * Exclusive locking is expensive: the writer scans all slots and waits until they are zero. Writers have priority: new
+ * readers wait while a writer is waiting. As with any writer-preferring mutex, a thread must not lock the mutex for
+ * reading twice.
+ *
+ * The mutex meets the SharedMutex requirements, Safe objects use std::shared_lock for read accesses by default.
+ * Each mutex takes slotCount cache lines.
+ */
+class DistributedSharedMutex
+{
+  public:
+    /// Number of reader slots. Threads are assigned slots in turn, more than slotCount threads share slots.
+    static constexpr std::size_t slotCount = 64;
+
+    DistributedSharedMutex() = default;
+    DistributedSharedMutex(const DistributedSharedMutex &) = delete;
+    DistributedSharedMutex &operator=(const DistributedSharedMutex &) = delete;
+
+    void lock()
+    {
+        m_writers.lock();
+        m_writer.store(true);
+        for (const Slot &slot : m_slots)
+        {
+            while (slot.readers.load() != 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool try_lock()
+    {
+        if (!m_writers.try_lock())
+        {
+            return false;
+        }
+        m_writer.store(true);
+        for (const Slot &slot : m_slots)
+        {
+            if (slot.readers.load() != 0)
+            {
+                unlock();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void unlock()
+    {
+        m_writer.store(false, std::memory_order_release);
+        m_writers.unlock();
+    }
+
+    void lock_shared()
+    {
+        std::atomic<unsigned> &readers = threadSlot().readers;
+        while (true)
+        {
+            readers.fetch_add(1);
+            if (!m_writer.load())
+            {
+                return;
+            }
+            readers.fetch_sub(1, std::memory_order_release);
+            // Sleep until the writer is done.
+            std::lock_guard<std::mutex> wait(m_writers);
+        }
+    }
+
+    bool try_lock_shared()
+    {
+        std::atomic<unsigned> &readers = threadSlot().readers;
+        readers.fetch_add(1);
+        if (!m_writer.load())
+        {
+            return true;
+        }
+        readers.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    void unlock_shared()
+    {
+        threadSlot().readers.fetch_sub(1, std::memory_order_release);
+    }
+
+  private:
+    /**
+     * @brief The shared lock count of some threads, alone on its cache line.
+     */
+    struct alignas(cacheLineSize) Slot
+    {
+        std::atomic<unsigned> readers{0};
+    };
+
+    /**
+     * @brief The slot of the calling thread. A thread keeps the same slot index for all mutexes.
+     */
+    Slot &threadSlot() noexcept
+    {
+        static std::atomic<std::size_t> nextIndex{0};
+        thread_local const std::size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed) % slotCount;
+        return m_slots[index];
+    }
+
+    // The reader's increment and the writer's store of m_writer are sequentially consistent, like the loads that follow
+    // them: either the reader sees the writer, or the writer sees the reader.
+    Slot m_slots[slotCount];
+    /// True while a writer owns or waits for the mutex.
+    std::atomic<bool> m_writer{false};
+    /// Serializes writers, readers lock it to sleep until a writer is done.
+    std::mutex m_writers;
+};
+
+#if __cplusplus >= 201402L
+namespace impl
+{
+// Readers of a DistributedSharedMutex take it in shared mode by default.
+template <> struct DefaultLocks<DistributedSharedMutex>
+{
+    using ReadOnly = std::shared_lock<DistributedSharedMutex>;
+    using ReadWrite = std::lock_guard<DistributedSharedMutex>;
+};
+} // namespace impl
+#endif // __cplusplus >= 201402L
+} // namespace safe
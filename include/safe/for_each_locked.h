@@ -0,0 +1,179 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "safe.h"
+
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+namespace safe
+{
+namespace impl
+{
+/// Try to lock a Safe object: write-lock non-const Safe objects and read-lock const Safe objects, like lockAll().
+template <typename SafeType> typename SafeType::template TryWriteAccess<> tryLockElement(SafeType &safe)
+{
+    return safe.tryWriteLock();
+}
+template <typename SafeType> typename SafeType::template TryReadAccess<> tryLockElement(const SafeType &safe)
+{
+    return safe.tryReadLock();
+}
+
+/**
+ * @brief Call function on the values of the Safe objects in [first, last): free ones first, busy ones in later passes.
+ */
+template <typename Iterator, typename Function> void forEachLocked(Iterator first, Iterator last, Function &function)
+{
+    std::vector<Iterator> busy;
+    for (; first != last; ++first)
+    {
+        auto access = tryLockElement(*first);
+        if (access)
+        {
+            function(*access);
+        }
+        else
+        {
+            busy.push_back(first);
+        }
+    }
+
+    // Revisit the busy Safe objects as long as some of them become free, then wait for the first one that is not.
+    while (!busy.empty())
+    {
+        std::size_t stillBusy = 0;
+        for (const Iterator element : busy)
+        {
+            auto access = tryLockElement(*element);
+            if (access)
+            {
+                function(*access);
+            }
+            else
+            {
+                busy[stillBusy++] = element;
+            }
+        }
+
+        if (stillBusy == busy.size())
+        {
+            auto access = tryLockElement(*busy.front());
+            if (!access)
+            {
+                access.lock.lock();
+            }
+            function(*access);
+            // The order of the visits is unspecified: swap and pop instead of erasing the front.
+            busy.front() = busy.back();
+            busy.pop_back();
+        }
+        else
+        {
+            busy.resize(stillBusy);
+        }
+    }
+}
+} // namespace impl
+
+/**
+ * @brief Call a function on the value of each Safe object of a range, without waiting behind busy ones while others
+ * are free: each Safe object is tried once, the ones whose mutex is locked are revisited after all the others.
+ *
+ * Like lockAll(), non-const Safe objects are write-locked and const Safe objects are read-locked: pass a const range to
+ * read. One Safe object is locked at a time, and the order in which the values are visited is unspecified. The Safe
+ * objects must provide tryReadLock() or tryWriteLock().
+ *
+ * With more than one thread, the range is split in as many contiguous parts, each swept by its own thread; the calling
+ * thread sweeps the last part. The function is then called concurrently on different values and must be thread-safe.
+ * If it throws, one of the exceptions is rethrown once all threads are done. If a thread cannot be started, the
+ * std::system_error is rethrown once the started threads are done, and the parts left are not swept.
+ *
+ * @tparam Range Deduced from range.
+ * @tparam Function Deduced from function.
+ * @param range The range of Safe objects, like a std::vector<safe::Safe<Session>>.
+ * @param function Function to call with a reference to each value.
+ * @param threadCount Number of threads that sweep the range.
+ */
+template <typename Range, typename Function>
+void forEachLocked(Range &&range, Function function, unsigned threadCount = 1)
+{
+    using std::begin;
+    using std::end;
+    using Iterator = decltype(begin(range));
+
+    Iterator first = begin(range);
+    const Iterator last = end(range);
+    const std::size_t size = static_cast<std::size_t>(std::distance(first, last));
+    if (threadCount > size)
+    {
+        threadCount = static_cast<unsigned>(size);
+    }
+    if (threadCount <= 1)
+    {
+        impl::forEachLocked(first, last, function);
+        return;
+    }
+
+    std::vector<std::exception_ptr> exceptions(threadCount);
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    try
+    {
+        for (unsigned index = 0; index + 1 < threadCount; ++index)
+        {
+            Iterator partLast = first;
+            std::advance(partLast, size / threadCount);
+            threads.emplace_back([first, partLast, &function, &exceptions, index]() {
+                try
+                {
+                    impl::forEachLocked(first, partLast, function);
+                }
+                catch (...)
+                {
+                    exceptions[index] = std::current_exception();
+                }
+            });
+            first = partLast;
+        }
+    }
+    catch (...)
+    {
+        // A thread could not be started: destroying the started ones while they are joinable would terminate.
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+        throw;
+    }
+    try
+    {
+        impl::forEachLocked(first, last, function);
+    }
+    catch (...)
+    {
+        exceptions.back() = std::current_exception();
+    }
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    for (const std::exception_ptr &exception : exceptions)
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+}
+} // namespace safe
@@ -0,0 +1,178 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "meta.h"
+#include "safe.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 201703L
+#define EXPLICIT_IF_CPP17 explicit
+#define EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17 ReturnType
+#else
+#define EXPLICIT_IF_CPP17
+#define EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17
+#endif
+
+namespace safe
+{
+/**
+ * @brief Safe object that can be frozen once it is initialized: from then on, read accesses do not lock the mutex and
+ * write accesses throw std::logic_error.
+ *
+ * Before it is frozen, a FreezableSafe object behaves like a Safe object, except that its read accesses use lock types
+ * that can defer locking (std::unique_lock instead of std::lock_guard). freeze() locks the mutex one last time, so that
+ * everything written before is visible to the readers that do not lock it.
+ *
+ * @tparam ValueType The type of the value to protect.
+ * @tparam MutexType The type of the mutex.
+ */
+template <typename ValueType, typename MutexType = std::mutex> class FreezableSafe
+{
+    /// The Safe object that holds the value and the mutex.
+    using SafeType = Safe<ValueType, MutexType>;
+    /// Type MutexType with reference removed, if present
+    using RemoveRefMutexType = typename std::remove_reference<MutexType>::type;
+
+    /**
+     * @brief WriteAccess of the underlying Safe object that throws std::logic_error if the FreezableSafe object is
+     * frozen.
+     *
+     * @tparam LockType The type of the lock object that manages the mutex, example: std::lock_guard.
+     */
+    template <template <typename> class LockType> class Access : public SafeType::template WriteAccess<LockType>
+    {
+        using Base = typename SafeType::template WriteAccess<LockType>;
+
+      public:
+        /**
+         * @brief Construct an Access object from a FreezableSafe object and any additionnal argument needed to
+         * construct the Lock object.
+         *
+         * @tparam OtherLockArgs Deduced from otherLockArgs.
+         * @param safe The FreezableSafe object to give protected access to.
+         * @param otherLockArgs Other arguments needed to construct the lock object.
+         * @throws std::logic_error if the FreezableSafe object is frozen, or if the lock does not own the mutex.
+         */
+        template <typename... OtherLockArgs>
+        EXPLICIT_IF_CPP17 Access(FreezableSafe &safe, OtherLockArgs &&...otherLockArgs)
+            : Base(safe.m_safe, std::forward<OtherLockArgs>(otherLockArgs)...)
+        {
+            // A lock that does not own the mutex yet (std::defer_lock, or a failed std::try_to_lock) could lock it
+            // after freeze().
+            if (!impl::ownsLock(this->lock, 0))
+            {
+                throw std::logic_error("FreezableSafe write accesses must own the mutex when they are constructed.");
+            }
+            // Checked after locking the mutex: freeze() cannot happen while this Access object owns it.
+            if (safe.frozen())
+            {
+                throw std::logic_error("Cannot write to a frozen FreezableSafe object.");
+            }
+        }
+    };
+
+  public:
+    /// Aliases to ReadAccess and WriteAccess classes for this FreezableSafe class.
+    template <template <typename> class LockType = DefaultTryReadOnlyLockType>
+    using ReadAccess = typename SafeType::template ReadAccess<LockType>;
+    template <template <typename> class LockType = DefaultReadWriteLockType> using WriteAccess = Access<LockType>;
+
+    /**
+     * @brief Construct a FreezableSafe object, forwarding all arguments to the constructor of Safe.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the value object and the mutex.
+     */
+    template <typename... Args> explicit FreezableSafe(Args &&...args) : m_safe(std::forward<Args>(args)...)
+    {
+    }
+
+    /// Delete all copy/move construction/assignment, as these operations require locking the mutex under the covers.
+    FreezableSafe(const FreezableSafe &) = delete;
+    FreezableSafe(FreezableSafe &&) = delete;
+    FreezableSafe &operator=(const FreezableSafe &) = delete;
+    FreezableSafe &operator=(FreezableSafe &&) = delete;
+
+    /**
+     * @brief Get a ReadAccess object. Locks the mutex only if the FreezableSafe object is not frozen.
+     *
+     * @tparam LockType The type of lock, must be constructible with std::defer_lock.
+     */
+    template <template <typename> class LockType = DefaultTryReadOnlyLockType> ReadAccess<LockType> readLock() const
+    {
+        ReadAccess<LockType> access(m_safe, std::defer_lock);
+        if (!frozen())
+        {
+            access.lock.lock();
+        }
+        return access;
+    }
+
+    /**
+     * @brief Lock the FreezableSafe object to get a WriteAccess object.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the lock object, which must lock the mutex.
+     * @throws std::logic_error if the FreezableSafe object is frozen, or if the lock does not own the mutex.
+     */
+    template <template <typename> class LockType = DefaultReadWriteLockType, typename... LockArgs>
+    WriteAccess<LockType> writeLock(LockArgs &&...lockArgs)
+    {
+        using ReturnType = WriteAccess<LockType>;
+        return EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17{*this, std::forward<LockArgs>(lockArgs)...};
+    }
+
+    /**
+     * @brief Freeze the FreezableSafe object, for good. Waits for the current write access, if any.
+     */
+    void freeze()
+    {
+        std::lock_guard<RemoveRefMutexType> lock(m_safe.mutex());
+        m_frozen.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Whether the FreezableSafe object is frozen.
+     */
+    bool frozen() const noexcept
+    {
+        return m_frozen.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Unsafe const accessor to the value. If you use this function, you exit the realm of safe!
+     */
+    const typename std::remove_reference<ValueType>::type &unsafe() const noexcept
+    {
+        return m_safe.unsafe();
+    }
+
+    /**
+     * @brief Accessor to the mutex.
+     *
+     * @return RemoveRefMutexType& Reference to the mutex.
+     */
+    RemoveRefMutexType &mutex() const noexcept
+    {
+        return m_safe.mutex();
+    }
+
+  private:
+    SafeType m_safe;
+    std::atomic<bool> m_frozen{false};
+};
+} // namespace safe
+
+#undef EXPLICIT_IF_CPP17
+#undef EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17
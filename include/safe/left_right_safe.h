@@ -0,0 +1,264 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "cache_line.h"
+#include "safe.h"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if __cplusplus >= 201703L
+#define EXPLICIT_IF_CPP17 explicit
+#else
+#define EXPLICIT_IF_CPP17
+#endif
+
+namespace safe
+{
+namespace impl
+{
+/**
+ * @brief Counts the readers that use one version of a LeftRightSafe object, on its own cache line.
+ */
+struct alignas(cacheLineSize) ReadIndicator
+{
+    void arrive() noexcept
+    {
+        readers.fetch_add(1);
+    }
+    void depart() noexcept
+    {
+        readers.fetch_sub(1, std::memory_order_release);
+    }
+    bool isEmpty() const noexcept
+    {
+        return readers.load() == 0;
+    }
+
+    std::atomic<std::size_t> readers{0};
+};
+} // namespace impl
+
+/**
+ * @brief Left-right alternative to Safe, for values that are read much more often than they are written and that are
+ * too large to copy on every write.
+ *
+ * Two instances of the value are kept. Readers are wait-free: they announce themselves on a read indicator and read
+ * the active instance without locking. Writers lock a mutex (writers exclude each other) and apply their modification
+ * to the inactive instance, switch readers over to it, wait for the readers of the other instance to leave, and apply
+ * the same modification to it. Writes cost twice the modification, but never allocate.
+ *
+ * @tparam ValueType The type of the value to protect, must be copy constructible and copy assignable.
+ * @tparam MutexType The type of the mutex that writers lock.
+ */
+template <typename ValueType, typename MutexType = std::mutex> class LeftRightSafe
+{
+  private:
+    /**
+     * @brief Read-only access to the active instance of the value. Keeps writers from modifying that instance until
+     * it is destroyed.
+     */
+    class Access
+    {
+      public:
+        /// Pointer-to-const ValueType
+        using ConstPointerType = const ValueType *;
+        /// Reference-to-const ValueType
+        using ConstReferenceType = const ValueType &;
+
+        /**
+         * @brief Construct a read-only Access object from a LeftRightSafe object.
+         *
+         * @param safe The LeftRightSafe object to give read-only access to.
+         */
+        EXPLICIT_IF_CPP17 Access(const LeftRightSafe &safe)
+            : m_readIndicator(&safe.m_readIndicators[safe.m_versionIndex.load()])
+        {
+            m_readIndicator->arrive();
+            m_value = &safe.instance(safe.m_leftRight.load());
+        }
+
+        Access(Access &&other) noexcept : m_readIndicator(other.m_readIndicator), m_value(other.m_value)
+        {
+            other.m_readIndicator = nullptr;
+        }
+        Access(const Access &) = delete;
+        Access &operator=(const Access &) = delete;
+        Access &operator=(Access &&) = delete;
+
+        ~Access()
+        {
+            if (m_readIndicator != nullptr)
+            {
+                m_readIndicator->depart();
+            }
+        }
+
+        /**
+         * @brief Const accessor to the value.
+         * @return ConstPointerType Const pointer to the protected value.
+         */
+        ConstPointerType operator->() const noexcept
+        {
+            return m_value;
+        }
+
+        /**
+         * @brief Const accessor to the value.
+         * @return ConstReferenceType Const reference to the protected value.
+         */
+        ConstReferenceType operator*() const noexcept
+        {
+            return *m_value;
+        }
+
+      private:
+        /// The read indicator this reader arrived on.
+        impl::ReadIndicator *m_readIndicator;
+        /// The instance this reader reads.
+        ConstPointerType m_value;
+    };
+
+  public:
+    /// Alias to the ReadAccess class for this LeftRightSafe class. Reads never lock, the LockType parameter is ignored.
+    template <template <typename> class LockType = DefaultReadOnlyLockType> using ReadAccess = Access;
+
+    /**
+     * @brief Construct a LeftRightSafe object, forwarding all arguments to construct the first instance of the value
+     * object. The second instance is a copy of the first.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the value object.
+     */
+    template <typename... Args>
+    explicit LeftRightSafe(Args &&...args) : m_left(std::forward<Args>(args)...), m_right(m_left)
+    {
+    }
+
+    /// Delete all copy/move construction/assignment, as these operations require locking the mutex under the covers.
+    LeftRightSafe(const LeftRightSafe &) = delete;
+    LeftRightSafe(LeftRightSafe &&) = delete;
+    LeftRightSafe &operator=(const LeftRightSafe &) = delete;
+    LeftRightSafe &operator=(LeftRightSafe &&) = delete;
+
+    /**
+     * @brief Get a ReadAccess object to the active instance of the value. Wait-free.
+     */
+    template <template <typename> class LockType = DefaultReadOnlyLockType> ReadAccess<LockType> readLock() const
+    {
+        return ReadAccess<LockType>(*this);
+    }
+
+    /**
+     * @brief Lock the writers' mutex and apply a modification to both instances of the value, one after the other.
+     *
+     * The function is called twice and must modify both instances identically: it must only depend on its argument
+     * and on the state of what it captures, which it must not modify.
+     *
+     * If the function throws, the instances are made identical again by copy assignment before the exception is
+     * propagated: if the first call throws, the value is left unchanged, if the second call throws, the value is the
+     * result of the first call. If that copy assignment throws too, std::terminate is called.
+     *
+     * @tparam Function Deduced from function.
+     * @param function Function that modifies the value, called with a ValueType& argument.
+     */
+    template <typename Function> void apply(Function &&function)
+    {
+        std::lock_guard<MutexType> lock(m_mutex);
+
+        const int leftRight = m_leftRight.load(std::memory_order_relaxed);
+        try
+        {
+            function(instance(1 - leftRight));
+        }
+        catch (...)
+        {
+            // Readers never saw the modified instance: undo the modification.
+            copy(instance(leftRight), instance(1 - leftRight));
+            throw;
+        }
+        m_leftRight.store(1 - leftRight);
+        toggleVersionAndWait();
+        try
+        {
+            function(instance(leftRight));
+        }
+        catch (...)
+        {
+            // Readers see the modified instance already: complete the modification.
+            copy(instance(1 - leftRight), instance(leftRight));
+            throw;
+        }
+    }
+
+    /**
+     * @brief Accessor to the writers' mutex.
+     *
+     * @return MutexType& Reference to the mutex.
+     */
+    MutexType &mutex() const noexcept
+    {
+        return m_mutex;
+    }
+
+  private:
+    /**
+     * @brief Make an instance that no reader reads identical to the other, or terminate.
+     */
+    static void copy(const ValueType &from, ValueType &to) noexcept
+    {
+        to = from;
+    }
+
+    ValueType &instance(int leftRight) noexcept
+    {
+        return leftRight == 0 ? m_left : m_right;
+    }
+    const ValueType &instance(int leftRight) const noexcept
+    {
+        return leftRight == 0 ? m_left : m_right;
+    }
+
+    /**
+     * @brief Move new readers to the other read indicator, and wait until no reader can still be reading the
+     * instance that is about to be modified.
+     */
+    void toggleVersionAndWait()
+    {
+        const int previous = m_versionIndex.load(std::memory_order_relaxed);
+        const int next = 1 - previous;
+        while (!m_readIndicators[next].isEmpty())
+        {
+            std::this_thread::yield();
+        }
+        m_versionIndex.store(next);
+        while (!m_readIndicators[previous].isEmpty())
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    /// The read indicators, one per version.
+    mutable impl::ReadIndicator m_readIndicators[2];
+    /// Index of the instance readers must use.
+    std::atomic<int> m_leftRight{0};
+    /// Index of the read indicator readers must arrive on.
+    std::atomic<int> m_versionIndex{0};
+    /// The mutex that writers lock.
+    mutable MutexType m_mutex;
+    /// The two instances of the value.
+    ValueType m_left;
+    ValueType m_right;
+};
+} // namespace safe
+
+#undef EXPLICIT_IF_CPP17
@@ -0,0 +1,177 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "meta.h"
+#include "safe.h"
+
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+namespace safe
+{
+namespace impl
+{
+/**
+ * @brief Type-erased reference to a lock object. Allows the locking algorithm to iterate over lock objects of
+ * different types.
+ */
+struct LockableRef
+{
+    void lock() const
+    {
+        lockFunction(object);
+    }
+    bool tryLock() const
+    {
+        return tryLockFunction(object);
+    }
+    void unlock() const
+    {
+        unlockFunction(object);
+    }
+
+    /// Pointer to the lock object.
+    void *object;
+    /// Pointer to the mutex the lock object manages.
+    const void *mutex;
+    void (*lockFunction)(void *);
+    bool (*tryLockFunction)(void *);
+    void (*unlockFunction)(void *);
+};
+
+template <typename LockType> struct LockableFunctions
+{
+    static void lock(void *object)
+    {
+        static_cast<LockType *>(object)->lock();
+    }
+    static bool tryLock(void *object)
+    {
+        return static_cast<LockType *>(object)->try_lock();
+    }
+    static void unlock(void *object)
+    {
+        static_cast<LockType *>(object)->unlock();
+    }
+};
+
+template <typename LockType> LockableRef makeLockableRef(LockType &lock)
+{
+    return {&lock, lock.mutex(), &LockableFunctions<LockType>::lock, &LockableFunctions<LockType>::tryLock,
+            &LockableFunctions<LockType>::unlock};
+}
+
+/**
+ * @brief Lock all the locks without deadlocking, using a try-and-back-off algorithm.
+ *
+ * Block on one lock, then try to lock the others. If one of them is busy, release everything and start over by
+ * blocking on the busy one. No global lock order is needed, so threads locking unrelated objects never wait on each
+ * other.
+ *
+ * @param locks Array of locks to lock, none of them must be owned.
+ * @param count Size of the array.
+ */
+inline void lockAll(const LockableRef *locks, std::size_t count)
+{
+    std::size_t first = 0;
+    while (true)
+    {
+        locks[first].lock();
+
+        std::size_t busy = count;
+        for (std::size_t offset = 1; offset < count; ++offset)
+        {
+            const std::size_t index = (first + offset) % count;
+            if (!locks[index].tryLock())
+            {
+                busy = index;
+                break;
+            }
+        }
+        if (busy == count)
+        {
+            return;
+        }
+
+        for (std::size_t index = first; index != busy; index = (index + 1) % count)
+        {
+            locks[index].unlock();
+        }
+        first = busy;
+        std::this_thread::yield();
+    }
+}
+
+template <typename AccessTuple, std::size_t... Is>
+void lockAll(AccessTuple &accesses, safe::impl::index_sequence<Is...>)
+{
+    const LockableRef locks[] = {makeLockableRef(std::get<Is>(accesses).lock)...};
+    // Safe objects may share a mutex (see safe::StripedPool). Only one lock could own it: the other Access objects
+    // would give access without owning the mutex, and those that act when they own it would do nothing.
+    for (std::size_t index = 0; index < sizeof...(Is); ++index)
+    {
+        for (std::size_t other = 0; other < index; ++other)
+        {
+            if (locks[index].mutex == locks[other].mutex)
+            {
+                throw std::logic_error("lockAll cannot lock Safe objects that share a mutex.");
+            }
+        }
+    }
+    lockAll(locks, sizeof...(Is));
+}
+
+/**
+ * @brief Type of Access object lockAll returns for a Safe object: WriteAccess for non-const Safe objects and
+ * ReadAccess for const Safe objects.
+ */
+template <template <typename> class ReadLockType, template <typename> class WriteLockType, typename SafeType>
+struct LockAllAccess
+{
+    using type = typename SafeType::template WriteAccess<WriteLockType>;
+};
+template <template <typename> class ReadLockType, template <typename> class WriteLockType, typename SafeType>
+struct LockAllAccess<ReadLockType, WriteLockType, const SafeType>
+{
+    using type = typename SafeType::template ReadAccess<ReadLockType>;
+};
+} // namespace impl
+
+/**
+ * @brief Lock several Safe objects at once without risk of deadlock.
+ *
+ * Non-const Safe objects are write-locked and const Safe objects are read-locked. The lock types must be movable,
+ * constructible with std::defer_lock and provide lock(), try_lock(), unlock() and mutex(): std::unique_lock for
+ * exclusive locking and std::shared_lock for shared locking fit the bill.
+ *
+ * Safe objects must not share a mutex: lockAll throws std::logic_error before locking anything if they do. Lock
+ * safe::StripedPool handles that may share a stripe with StripedPool::lockBoth() instead.
+ *
+ * @tparam ReadLockType The type of lock used for const Safe objects.
+ * @tparam WriteLockType The type of lock used for non-const Safe objects.
+ * @tparam SafeTypes Deduced from safes.
+ * @param safes The Safe objects to lock.
+ * @return A tuple of Access objects, in the same order as the arguments.
+ */
+template <template <typename> class ReadLockType = std::unique_lock,
+          template <typename> class WriteLockType = std::unique_lock, typename... SafeTypes>
+std::tuple<typename impl::LockAllAccess<ReadLockType, WriteLockType, SafeTypes>::type...> lockAll(
+    SafeTypes &...safes)
+{
+    static_assert(sizeof...(SafeTypes) != 0, "lockAll needs at least one Safe object to lock.");
+
+    std::tuple<typename impl::LockAllAccess<ReadLockType, WriteLockType, SafeTypes>::type...> accesses(
+        typename impl::LockAllAccess<ReadLockType, WriteLockType, SafeTypes>::type(safes, std::defer_lock)...);
+    impl::lockAll(accesses, safe::impl::make_index_sequence<sizeof...(SafeTypes)>());
+    return accesses;
+}
+} // namespace safe
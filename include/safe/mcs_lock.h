@@ -0,0 +1,226 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "backoff.h"
+#include "cache_line.h"
+#include "default_locks.h"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+namespace safe
+{
+/**
+ * @brief MCS queue lock: waiting threads form a queue, each one spins on its own node and is handed the lock by its
+ * predecessor. Waiters do not disturb each other nor the owner, and get the lock in order.
+ *
+ * The node of a thread lives in its lock object, safe::McsGuard, which Safe objects use by default: no allocation and
+ * no thread-local storage are needed. McsLock also meets the Lockable requirements, for lock types that do not hold a
+ * node (std::unique_lock, as used by tryWriteLock() and safe::lockAll()): lock() then takes a node from a small
+ * thread-local pool, so a thread can hold at most maxThreadNodes McsLocks this way at a time. Waiters spin, then yield:
+ * use it for short critical sections.
+ */
+class McsLock
+{
+  public:
+    /**
+     * @brief A thread's place in the queue. It must not move while the mutex is locked or awaited.
+     */
+    struct alignas(cacheLineSize) Node
+    {
+        std::atomic<Node *> next{nullptr};
+        std::atomic<bool> waiting{false};
+    };
+
+    /// How many McsLocks a thread can hold at a time through lock() and try_lock(), without a node of its own.
+    static constexpr std::size_t maxThreadNodes = 8;
+
+    McsLock() = default;
+    McsLock(const McsLock &) = delete;
+    McsLock &operator=(const McsLock &) = delete;
+
+    /**
+     * @brief Lock with a node of the calling thread's pool.
+     *
+     * @throws std::system_error If the thread already holds maxThreadNodes McsLocks through lock() or try_lock().
+     */
+    void lock()
+    {
+        lock(acquireThreadNode());
+    }
+    bool try_lock()
+    {
+        Node &node = acquireThreadNode();
+        if (try_lock(node))
+        {
+            return true;
+        }
+        releaseThreadNode(node);
+        return false;
+    }
+    /**
+     * @brief Unlock a mutex locked with lock() or try_lock(), on the same thread.
+     */
+    void unlock() noexcept
+    {
+        Node &node = threadNode();
+        unlock(node);
+        releaseThreadNode(node);
+    }
+
+    void lock(Node &node) noexcept
+    {
+        node.next.store(nullptr, std::memory_order_relaxed);
+        node.waiting.store(true, std::memory_order_relaxed);
+        Node *const predecessor = m_tail.exchange(&node, std::memory_order_acq_rel);
+        if (predecessor == nullptr)
+        {
+            return;
+        }
+        predecessor->next.store(&node, std::memory_order_release);
+        for (unsigned spin = 0; node.waiting.load(std::memory_order_acquire); ++spin)
+        {
+            pause(spin);
+        }
+    }
+
+    bool try_lock(Node &node) noexcept
+    {
+        node.next.store(nullptr, std::memory_order_relaxed);
+        Node *expected = nullptr;
+        return m_tail.compare_exchange_strong(expected, &node, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock(Node &node) noexcept
+    {
+        Node *successor = node.next.load(std::memory_order_acquire);
+        if (successor == nullptr)
+        {
+            Node *expected = &node;
+            if (m_tail.compare_exchange_strong(expected, nullptr, std::memory_order_release,
+                                               std::memory_order_relaxed))
+            {
+                return;
+            }
+            // A successor swapped the tail but has not linked itself yet.
+            for (unsigned spin = 0; (successor = node.next.load(std::memory_order_acquire)) == nullptr; ++spin)
+            {
+                pause(spin);
+            }
+        }
+        successor->waiting.store(false, std::memory_order_release);
+    }
+
+  private:
+    /**
+     * @brief The nodes of a thread, for lock() and try_lock(), and the McsLock each one is used for.
+     */
+    struct ThreadNodes
+    {
+        Node nodes[maxThreadNodes];
+        const McsLock *owners[maxThreadNodes] = {};
+    };
+
+    static ThreadNodes &threadNodes() noexcept
+    {
+        static thread_local ThreadNodes nodes;
+        return nodes;
+    }
+
+    Node &acquireThreadNode()
+    {
+        ThreadNodes &nodes = threadNodes();
+        for (std::size_t index = 0; index < maxThreadNodes; ++index)
+        {
+            if (nodes.owners[index] == nullptr)
+            {
+                nodes.owners[index] = this;
+                return nodes.nodes[index];
+            }
+        }
+        throw std::system_error(std::make_error_code(std::errc::resource_unavailable_try_again),
+                                "This thread holds too many McsLocks without a node of its own.");
+    }
+    Node &threadNode() noexcept
+    {
+        ThreadNodes &nodes = threadNodes();
+        std::size_t index = 0;
+        while (nodes.owners[index] != this)
+        {
+            ++index;
+        }
+        return nodes.nodes[index];
+    }
+    static void releaseThreadNode(Node &node) noexcept
+    {
+        ThreadNodes &nodes = threadNodes();
+        nodes.owners[&node - nodes.nodes] = nullptr;
+    }
+
+    static void pause(unsigned spin) noexcept
+    {
+        // Spin for a while, then let the thread we are waiting for run if it shares our core.
+        if (spin < 128)
+        {
+            impl::cpuRelax();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    /// The last node of the queue, nullptr if the mutex is unlocked.
+    std::atomic<Node *> m_tail{nullptr};
+};
+
+/**
+ * @brief Lock object for safe::McsLock, like std::lock_guard: locks the mutex when constructed and unlocks it when
+ * destroyed. It holds the queue node, and cannot be copied or moved: functions that need a movable lock or that try to
+ * lock, like tryWriteLock() and safe::lockAll(), use std::unique_lock and McsLock's thread-local nodes instead.
+ *
+ * @tparam MutexType The type of the mutex, safe::McsLock.
+ */
+template <typename MutexType> class McsGuard
+{
+  public:
+    explicit McsGuard(MutexType &mutex) : m_mutex(mutex)
+    {
+        m_mutex.lock(m_node);
+    }
+    McsGuard(const McsGuard &) = delete;
+    McsGuard &operator=(const McsGuard &) = delete;
+    ~McsGuard()
+    {
+        m_mutex.unlock(m_node);
+    }
+
+  private:
+    typename MutexType::Node m_node;
+    MutexType &m_mutex;
+};
+
+namespace impl
+{
+// McsGuard holds the node, so that locking needs no thread-local storage.
+template <> struct DefaultLocks<McsLock>
+{
+    using ReadOnly = McsGuard<McsLock>;
+    using ReadWrite = McsGuard<McsLock>;
+};
+// McsGuard cannot try to lock nor move: try with std::unique_lock.
+template <typename MutexType> struct TryLocks<McsGuard<MutexType>>
+{
+    template <typename OtherMutexType> using Type = std::unique_lock<OtherMutexType>;
+};
+} // namespace impl
+} // namespace safe
@@ -46,6 +46,16 @@ constexpr typename index_sequence<N>::type make_index_sequence()
 {
     return {};
 }
+
+// Detect lock types that may not own their mutex, like std::unique_lock.
+template <typename LockType> auto ownsLock(const LockType &lock, int) -> decltype(lock.owns_lock())
+{
+    return lock.owns_lock();
+}
+template <typename LockType> bool ownsLock(const LockType &, long)
+{
+    return true;
+}
 } // namespace impl
 
 template <typename... Ts> using Last = typename impl::Last<Ts...>::type;
@@ -21,6 +21,12 @@ namespace impl
  */
 template <typename Type> struct MutableIfNotReference
 {
+    MutableIfNotReference() = default;
+    /// Construct the object in place, so that Type needs not be movable.
+    template <typename Arg> explicit MutableIfNotReference(Arg &&arg) : get(std::forward<Arg>(arg))
+    {
+    }
+
     /// Mutable Type object.
     mutable Type get;
 };
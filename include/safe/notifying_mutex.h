@@ -0,0 +1,180 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+
+namespace safe
+{
+/**
+ * @brief Mutex that threads can wait on until a predicate holds, without a separate condition variable: see
+ * Safe::waitUntil() and Safe::waitFor().
+ *
+ * When the mutex is unlocked, the predicates of the waiting threads are evaluated, oldest waiter first, and only the
+ * first waiter whose predicate holds is woken up. That waiter unlocks the mutex in turn, which wakes up the next one if
+ * its predicate still holds: waiters are only woken up when their predicate holds, and one at a time.
+ *
+ * Predicates are evaluated by the unlocking thread while it holds the mutex, so they must be cheap: every unlock, even
+ * that of a read-only access, evaluates the predicates of the waiters until one holds. If a predicate throws, its
+ * waiter is woken up and the exception is rethrown on the waiting thread.
+ */
+class NotifyingMutex
+{
+  public:
+    void lock()
+    {
+        m_mutex.lock();
+    }
+    bool try_lock()
+    {
+        return m_mutex.try_lock();
+    }
+    void unlock()
+    {
+        notifyOne();
+        m_mutex.unlock();
+    }
+
+    /**
+     * @brief Wait until predicate holds. The calling thread must own the mutex, and owns it when the function returns
+     * or throws. Exceptions thrown by predicate are rethrown on this thread.
+     *
+     * @tparam Predicate Deduced from predicate.
+     * @param predicate Function without arguments that returns true when the wait is over.
+     */
+    template <typename Predicate> void wait(Predicate &predicate)
+    {
+        Waiter waiter(predicate);
+        while (!predicate())
+        {
+            enqueue(waiter);
+            std::unique_lock<std::mutex> lock(m_mutex, std::adopt_lock);
+            waiter.condition.wait(lock, [&]() { return waiter.signaled; });
+            lock.release();
+            waiter.signaled = false;
+            waiter.rethrowIfFailed();
+        }
+    }
+
+    /**
+     * @brief Wait until predicate holds, or until the deadline. The calling thread must own the mutex, and owns it
+     * when the function returns or throws. Exceptions thrown by predicate are rethrown on this thread.
+     *
+     * @tparam Predicate Deduced from predicate.
+     * @param predicate Function without arguments that returns true when the wait is over.
+     * @param deadline Time point after which to stop waiting.
+     * @return bool The value of the predicate when the function returns.
+     */
+    template <typename Predicate>
+    bool waitUntil(Predicate &predicate, std::chrono::steady_clock::time_point deadline)
+    {
+        Waiter waiter(predicate);
+        while (!predicate())
+        {
+            enqueue(waiter);
+            std::unique_lock<std::mutex> lock(m_mutex, std::adopt_lock);
+            const bool signaled = waiter.condition.wait_until(lock, deadline, [&]() { return waiter.signaled; });
+            lock.release();
+            if (!signaled)
+            {
+                remove(waiter);
+                return predicate();
+            }
+            waiter.signaled = false;
+            waiter.rethrowIfFailed();
+        }
+        return true;
+    }
+
+  private:
+    /**
+     * @brief A waiting thread, on its own stack.
+     */
+    struct Waiter
+    {
+        template <typename Predicate>
+        explicit Waiter(Predicate &predicate)
+            : check([](void *erased) { return (*static_cast<Predicate *>(erased))(); }), predicate(&predicate)
+        {
+        }
+
+        void rethrowIfFailed()
+        {
+            if (exception)
+            {
+                std::rethrow_exception(exception);
+            }
+        }
+
+        bool (*check)(void *);
+        void *predicate;
+        std::condition_variable condition;
+        bool signaled = false;
+        /// Exception thrown by the predicate when another thread evaluated it.
+        std::exception_ptr exception;
+        Waiter *next = nullptr;
+    };
+
+    // All these functions must be called with the mutex locked.
+    void enqueue(Waiter &waiter) noexcept
+    {
+        waiter.next = nullptr;
+        Waiter **last = &m_waiters;
+        while (*last != nullptr)
+        {
+            last = &(*last)->next;
+        }
+        *last = &waiter;
+    }
+    void remove(Waiter &waiter) noexcept
+    {
+        for (Waiter **current = &m_waiters; *current != nullptr; current = &(*current)->next)
+        {
+            if (*current == &waiter)
+            {
+                *current = waiter.next;
+                return;
+            }
+        }
+    }
+    void notifyOne() noexcept
+    {
+        for (Waiter **current = &m_waiters; *current != nullptr; current = &(*current)->next)
+        {
+            Waiter &waiter = **current;
+            bool holds;
+            try
+            {
+                holds = waiter.check(waiter.predicate);
+            }
+            catch (...)
+            {
+                // Wake the waiter up so that it rethrows the exception.
+                waiter.exception = std::current_exception();
+                holds = true;
+            }
+            if (holds)
+            {
+                *current = waiter.next;
+                waiter.signaled = true;
+                // Notify while holding the mutex: the waiter is on the stack of a thread that may wake up spuriously
+                // and return as soon as the mutex is unlocked.
+                waiter.condition.notify_one();
+                return;
+            }
+        }
+    }
+
+    std::mutex m_mutex;
+    /// The waiting threads, oldest first.
+    Waiter *m_waiters = nullptr;
+};
+} // namespace safe
@@ -0,0 +1,182 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "safe.h"
+
+#if __cplusplus >= 201703L
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace safe
+{
+/**
+ * @brief Safe object whose container allocates from a memory resource of its own, instead of the global allocator.
+ *
+ * The container only allocates with the mutex locked, so the resource needs no synchronization: by default, it is a
+ * std::pmr::unsynchronized_pool_resource. Allocations do not contend with other threads, which keeps the critical
+ * sections that allocate short.
+ *
+ * Memory from the resource must only be used with the mutex locked: do not move the container, or anything that uses
+ * its allocator, out of a WriteAccess object. Copies use the default resource and are not concerned.
+ *
+ * @tparam Container The type of the container to protect, must use a std::pmr::polymorphic_allocator, like
+ * std::pmr::unordered_map.
+ * @tparam Resource The type of the memory resource, like std::pmr::unsynchronized_pool_resource or
+ * std::pmr::monotonic_buffer_resource.
+ * @tparam MutexType The type of the mutex.
+ */
+template <typename Container, typename Resource = std::pmr::unsynchronized_pool_resource,
+          typename MutexType = std::mutex>
+class PmrSafe
+{
+    static_assert(std::is_constructible<typename Container::allocator_type, std::pmr::memory_resource *>::value,
+                  "PmrSafe requires a Container that uses a std::pmr::polymorphic_allocator.");
+
+    /// The Safe object that holds the container and the mutex.
+    using SafeType = Safe<Container, MutexType>;
+
+  public:
+    /// Aliases to ReadAccess and WriteAccess classes for this PmrSafe class.
+    template <template <typename> class LockType = DefaultReadOnlyLockType>
+    using ReadAccess = typename SafeType::template ReadAccess<LockType>;
+    template <template <typename> class LockType = DefaultReadWriteLockType>
+    using WriteAccess = typename SafeType::template WriteAccess<LockType>;
+
+    /**
+     * @brief Construct a PmrSafe object: the container is constructed from the arguments followed by an allocator that
+     * uses the resource, and the mutex is default constructed.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the container, without the allocator.
+     */
+    template <typename... Args>
+    explicit PmrSafe(Args &&...args) : m_safe(std::forward<Args>(args)..., allocator(), default_construct_mutex)
+    {
+    }
+
+    /**
+     * @brief Construct a PmrSafe object whose resource is constructed from arguments, for instance an upstream resource,
+     * pool options or a buffer: PmrSafe(std::piecewise_construct, std::forward_as_tuple(resourceArgs...),
+     * std::forward_as_tuple(containerArgs...)).
+     *
+     * @param resourceArgs Arguments to construct the resource.
+     * @param containerArgs Arguments to construct the container, without the allocator.
+     */
+    template <typename... ResourceArgs, typename... ContainerArgs>
+    PmrSafe(std::piecewise_construct_t, std::tuple<ResourceArgs...> resourceArgs,
+            std::tuple<ContainerArgs...> containerArgs)
+        : PmrSafe(PiecewiseTag(), std::move(resourceArgs), std::move(containerArgs),
+                  std::index_sequence_for<ContainerArgs...>())
+    {
+    }
+
+    /// Delete all copy/move construction/assignment, as these operations require locking the mutex under the covers.
+    PmrSafe(const PmrSafe &) = delete;
+    PmrSafe(PmrSafe &&) = delete;
+    PmrSafe &operator=(const PmrSafe &) = delete;
+    PmrSafe &operator=(PmrSafe &&) = delete;
+
+    /**
+     * @brief Lock the PmrSafe object to get a ReadAccess object.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the lock object.
+     */
+    template <template <typename> class LockType = DefaultReadOnlyLockType, typename... LockArgs>
+    ReadAccess<LockType> readLock(LockArgs &&...lockArgs) const
+    {
+        return ReadAccess<LockType>(m_safe, std::forward<LockArgs>(lockArgs)...);
+    }
+
+    /**
+     * @brief Lock the PmrSafe object to get a WriteAccess object.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the lock object.
+     */
+    template <template <typename> class LockType = DefaultReadWriteLockType, typename... LockArgs>
+    WriteAccess<LockType> writeLock(LockArgs &&...lockArgs)
+    {
+        return WriteAccess<LockType>(m_safe, std::forward<LockArgs>(lockArgs)...);
+    }
+
+    /**
+     * @brief Empty the container and give all the memory of the resource back to its upstream resource, including
+     * what a pool or monotonic resource keeps for later allocations.
+     *
+     * The container is destroyed, the resource is released, and an empty container is constructed from an allocator
+     * that uses the resource. Some empty containers allocate (like std::deque) or are not declared noexcept (like
+     * std::unordered_map): if this constructor throws, there is no container left to leave in place and
+     * std::terminate is called.
+     */
+    void reset()
+    {
+        std::lock_guard<std::remove_reference_t<MutexType>> lock(m_safe.mutex());
+        Container &container = m_safe.unsafe();
+        container.~Container();
+        m_resource.release();
+        [&]() noexcept { ::new (static_cast<void *>(&container)) Container(allocator()); }();
+    }
+
+    /**
+     * @brief Unsafe const accessor to the container. If you use this function, you exit the realm of safe!
+     */
+    const Container &unsafe() const noexcept
+    {
+        return m_safe.unsafe();
+    }
+
+    /**
+     * @brief Unsafe accessor to the resource, for instance to read its statistics. Lock the mutex first!
+     */
+    const Resource &resource() const noexcept
+    {
+        return m_resource;
+    }
+
+    /**
+     * @brief Accessor to the mutex.
+     *
+     * @return Reference to the mutex.
+     */
+    std::remove_reference_t<MutexType> &mutex() const noexcept
+    {
+        return m_safe.mutex();
+    }
+
+  private:
+    struct PiecewiseTag
+    {
+    };
+
+    template <typename ResourceTuple, typename ContainerTuple, std::size_t... ContainerIs>
+    PmrSafe(PiecewiseTag, ResourceTuple &&resourceArgs, ContainerTuple &&containerArgs,
+            std::index_sequence<ContainerIs...>)
+        : m_resource(std::make_from_tuple<Resource>(std::forward<ResourceTuple>(resourceArgs))),
+          m_safe(std::get<ContainerIs>(std::forward<ContainerTuple>(containerArgs))..., allocator(),
+                 default_construct_mutex)
+    {
+    }
+
+    typename Container::allocator_type allocator() noexcept
+    {
+        return typename Container::allocator_type(&m_resource);
+    }
+
+    /// Declared before the Safe object, so that it outlives the container.
+    Resource m_resource;
+    SafeType m_safe;
+};
+} // namespace safe
+#endif // __cplusplus >= 201703L
@@ -0,0 +1,239 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace safe
+{
+/**
+ * @brief Mutex to which functions can be posted instead of locking it: see Safe::post(). Posting never waits for the
+ * thread that holds the mutex, the posted functions are called in order by the next thread that locks the mutex, right
+ * after locking it. Whoever locks the mutex sees the effects of all functions posted before.
+ *
+ * Posted functions must not throw. Functions still pending when the mutex is destroyed are not called: lock the mutex
+ * or use a safe::Strand to make sure they are.
+ */
+class PostingMutex
+{
+  public:
+    PostingMutex() = default;
+    PostingMutex(const PostingMutex &) = delete;
+    PostingMutex &operator=(const PostingMutex &) = delete;
+    ~PostingMutex()
+    {
+        Node *node = m_head.load(std::memory_order_relaxed);
+        while (node != nullptr)
+        {
+            Node *const next = node->next.load(std::memory_order_relaxed);
+            if (node != &m_stub)
+            {
+                node->destroy(node);
+            }
+            node = next;
+        }
+    }
+
+    void lock()
+    {
+        m_mutex.lock();
+        callPending();
+    }
+    bool try_lock()
+    {
+        if (m_mutex.try_lock())
+        {
+            callPending();
+            return true;
+        }
+        return false;
+    }
+    void unlock()
+    {
+        m_mutex.unlock();
+    }
+
+    /**
+     * @brief Queue a function, to be called by the next thread that locks the mutex.
+     *
+     * Does not wait for the thread that holds the mutex, nor for other posting threads, but allocates the queue node
+     * with new: posting is only as fast and as wait-free as the allocator. If a safe::Strand sleeps, waiting for
+     * posts, posting also locks the Strand's internal mutex briefly to wake it up.
+     *
+     * @tparam Function Deduced from function.
+     * @param function Function to call, without arguments.
+     */
+    template <typename Function> void post(Function &&function)
+    {
+        Node *const node = new FunctionNode<typename std::decay<Function>::type>(std::forward<Function>(function));
+        Node *const previous = m_tail.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+
+        // Pairs with the fence in waitPosted(): either the Strand sees the new tail, or this sees that it sleeps.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_sleeping.load(std::memory_order_relaxed))
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+            }
+            m_posted.notify_one();
+        }
+    }
+
+    /**
+     * @brief Whether functions were posted since the mutex was last locked. Can be called without locking the mutex,
+     * the result is a hint.
+     */
+    bool pending() const noexcept
+    {
+        return m_tail.load(std::memory_order_relaxed) != m_head.load(std::memory_order_relaxed);
+    }
+
+  private:
+    template <typename> friend class Strand;
+
+    /**
+     * @brief Sleep until functions are posted, or until wake() is called. For safe::Strand.
+     */
+    void waitPosted()
+    {
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_posted.wait(lock, [this]() { return m_woken || pending(); });
+        m_woken = false;
+        m_sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Wake the thread that sleeps in waitPosted(), or make its next call return right away.
+     */
+    void wake()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_woken = true;
+        }
+        m_posted.notify_one();
+    }
+
+    /**
+     * @brief A posted function, in an intrusive queue. The stub node has no function.
+     */
+    struct Node
+    {
+        std::atomic<Node *> next{nullptr};
+        void (*call)(Node &) = nullptr;
+        void (*destroy)(Node *) = nullptr;
+    };
+    template <typename Function> struct FunctionNode : Node
+    {
+        template <typename Argument>
+        explicit FunctionNode(Argument &&argument) : function(std::forward<Argument>(argument))
+        {
+            this->call = [](Node &node) { static_cast<FunctionNode &>(node).function(); };
+            this->destroy = [](Node *node) { delete static_cast<FunctionNode *>(node); };
+        }
+
+        Function function;
+    };
+
+    /**
+     * @brief Call the functions posted before this call, in order. The mutex must be locked.
+     */
+    void callPending() noexcept
+    {
+        Node *head = m_head.load(std::memory_order_relaxed);
+        Node *const last = m_tail.load(std::memory_order_acquire);
+        while (head != last)
+        {
+            Node *next;
+            // A producer swapped the tail but has not linked its node yet.
+            while ((next = head->next.load(std::memory_order_acquire)) == nullptr)
+            {
+                std::this_thread::yield();
+            }
+            next->call(*next);
+            // The node of the last called function stays in the queue, as the new head.
+            if (head != &m_stub)
+            {
+                head->destroy(head);
+            }
+            head = next;
+        }
+        m_head.store(head, std::memory_order_relaxed);
+    }
+
+    std::mutex m_mutex;
+    /// Head of the queue: the node of the last called function, or the stub. Only modified with the mutex locked.
+    std::atomic<Node *> m_head{&m_stub};
+    /// Tail of the queue: the node of the last posted function, or the stub.
+    std::atomic<Node *> m_tail{&m_stub};
+    Node m_stub;
+
+    /// Where a safe::Strand sleeps while no function is posted.
+    std::mutex m_sleepMutex;
+    std::condition_variable m_posted;
+    std::atomic<bool> m_sleeping{false};
+    bool m_woken = false;
+};
+
+/**
+ * @brief Background thread that locks the mutex of a Safe object to call the functions posted to it (see
+ * safe::PostingMutex). It sleeps while no function is posted, and posting wakes it up. When destroyed, it calls the
+ * functions still pending: declare it after the Safe object. Use at most one Strand per Safe object.
+ *
+ * @tparam SafeType The type of the Safe object.
+ */
+template <typename SafeType> class Strand
+{
+    using MutexType = typename std::remove_reference<decltype(std::declval<SafeType &>().mutex())>::type;
+
+  public:
+    /**
+     * @brief Construct a Strand object and start its thread.
+     *
+     * @param safe The Safe object whose posted functions to call.
+     */
+    explicit Strand(SafeType &safe) : m_safe(safe), m_thread([this]() { run(); })
+    {
+    }
+    Strand(const Strand &) = delete;
+    Strand &operator=(const Strand &) = delete;
+    ~Strand()
+    {
+        m_stop.store(true, std::memory_order_relaxed);
+        m_safe.mutex().wake();
+        m_thread.join();
+        std::lock_guard<MutexType> lock(m_safe.mutex());
+    }
+
+  private:
+    void run()
+    {
+        while (true)
+        {
+            m_safe.mutex().waitPosted();
+            if (m_stop.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+            std::lock_guard<MutexType> lock(m_safe.mutex());
+        }
+    }
+
+    SafeType &m_safe;
+    std::atomic<bool> m_stop{false};
+    std::thread m_thread;
+};
+} // namespace safe
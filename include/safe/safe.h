@@ -8,10 +8,14 @@
 #pragma once
 
 #include "access_mode.h"
+#include "backoff.h"
 #include "default_locks.h"
 #include "meta.h"
 #include "mutable_ref.h"
 
+#include <cassert>
+#include <chrono>
+#include <mutex>
 #include <type_traits>
 #include <utility>
 
@@ -25,11 +29,78 @@
 
 namespace safe
 {
+// Defined in upgrade_mutex.h: include it to lock Safe objects in upgrade mode.
+template <typename MutexType> class UpgradeLock;
+
 namespace impl
 {
 struct DefaultConstructMutex
 {
 };
+
+// Mutexes that can call a function on behalf of the caller (like safe::CombiningMutex) do so, other mutexes are locked
+// using LockType.
+template <template <typename> class LockType, typename MutexType, typename Function>
+auto lockAndCall(MutexType &mutex, Function &function, int) -> decltype(mutex.combine(function))
+{
+    mutex.combine(function);
+}
+template <template <typename> class LockType, typename MutexType, typename Function>
+void lockAndCall(MutexType &mutex, Function &function, long)
+{
+    LockType<MutexType> lock(mutex);
+    function();
+}
+
+/**
+ * @brief Function object that calls a function with a reference to a value, for Safe::post().
+ */
+template <typename Function, typename ValueType> struct BoundFunction
+{
+    void operator()()
+    {
+        function(value);
+    }
+
+    Function function;
+    ValueType &value;
+};
+
+#if __cplusplus >= 202002L
+/**
+ * @brief Awaitable that locks a mutex asynchronously (like safe::AsyncMutex) and gives an Access object once the
+ * mutex is locked.
+ *
+ * @tparam AccessType The type of Access object, its lock must accept std::adopt_lock.
+ * @tparam SafeType The type of the (possibly const) Safe object.
+ * @tparam LockAwaiter The type of the awaitable returned by the mutex's lockAsync() function.
+ */
+template <typename AccessType, typename SafeType, typename LockAwaiter> class AsyncAccessAwaiter
+{
+  public:
+    AsyncAccessAwaiter(SafeType &safe, LockAwaiter lockAwaiter) : m_safe(safe), m_lockAwaiter(lockAwaiter)
+    {
+    }
+
+    bool await_ready()
+    {
+        return m_lockAwaiter.await_ready();
+    }
+    template <typename Handle> auto await_suspend(Handle handle)
+    {
+        return m_lockAwaiter.await_suspend(handle);
+    }
+    AccessType await_resume()
+    {
+        m_lockAwaiter.await_resume();
+        return AccessType(m_safe, std::adopt_lock);
+    }
+
+  private:
+    SafeType &m_safe;
+    LockAwaiter m_lockAwaiter;
+};
+#endif // __cplusplus >= 202002L
 } // namespace impl
 
 /**
@@ -55,8 +126,8 @@ template <typename ValueType, typename MutexType = std::mutex> class Safe
      * @brief Manages a mutex and gives pointer-like access to a value object.
      *
      * @tparam LockType The type of the lock object that manages the mutex, example: std::lock_guard.
-     * @tparam Mode Determines the access mode of the Access object. Can be either AccessMode::ReadOnly or
-     * AccessMode::ReadWrite.
+     * @tparam Mode Determines the access mode of the Access object. Can be AccessMode::ReadOnly,
+     * AccessMode::ReadWrite or AccessMode::Upgradeable.
      */
     template <template <typename> class LockType, AccessMode Mode> class Access
     {
@@ -66,9 +137,9 @@ template <typename ValueType, typename MutexType = std::mutex> class Safe
                       "Check the value of "
                       "AccessTraits<LockType>::IsReadOnly if it exists.");
 
-        /// ValueType with const qualifier if AccessMode is ReadOnly.
+        /// ValueType with const qualifier if AccessMode is not ReadWrite.
         using ConstIfReadOnlyValueType =
-            typename std::conditional<Mode == AccessMode::ReadOnly, const RemoveRefValueType, RemoveRefValueType>::type;
+            typename std::conditional<Mode != AccessMode::ReadWrite, const RemoveRefValueType, RemoveRefValueType>::type;
 
       public:
         /// Pointer-to-const ValueType
@@ -110,6 +181,7 @@ template <typename ValueType, typename MutexType = std::mutex> class Safe
         EXPLICIT_IF_CPP17 Access(const Safe &safe, OtherLockArgs &&...otherLockArgs)
             : Access(safe.m_value, safe.m_mutex.get, std::forward<OtherLockArgs>(otherLockArgs)...)
         {
+            static_assert(Mode != AccessMode::Upgradeable, "Cannot upgrade the access to a const Safe object.");
         }
 
         /**
@@ -166,6 +238,24 @@ template <typename ValueType, typename MutexType = std::mutex> class Safe
             return m_value;
         }
 
+        /**
+         * @brief Atomically turn an Upgradeable access into a ReadWrite access: no writer or upgrader can modify the
+         * value in between. The lock must own the mutex. This Access object must not be used afterwards.
+         *
+         * @return Access<std::unique_lock, AccessMode::ReadWrite> ReadWrite access that owns the lock.
+         */
+        template <AccessMode ThisMode = Mode,
+                  typename std::enable_if<ThisMode == AccessMode::Upgradeable, bool>::type = true>
+        Access<std::unique_lock, AccessMode::ReadWrite> upgrade()
+        {
+            using ReturnType = Access<std::unique_lock, AccessMode::ReadWrite>;
+            assert(impl::ownsLock(lock, 0));
+            lock.mutex()->unlock_upgrade_and_lock();
+            // Upgradeable accesses are only constructed from non-const Safe objects.
+            return EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17{const_cast<RemoveRefValueType &>(m_value),
+                                                             *lock.release(), std::adopt_lock};
+        }
+
         /// The lock that manages the mutex.
         mutable LockType<RemoveRefMutexType> lock;
 
@@ -174,6 +264,52 @@ template <typename ValueType, typename MutexType = std::mutex> class Safe
         ReferenceType m_value;
     };
 
+    /**
+     * @brief Access object whose lock may not own the mutex, like an optional Access object: convert it to bool before
+     * dereferencing it. Dereferencing a TryAccess object that does not own the mutex is undefined behavior, like
+     * dereferencing an empty std::optional.
+     *
+     * @tparam LockType The type of the lock object that manages the mutex, must be able to try to lock it.
+     * @tparam Mode Determines the access mode of the TryAccess object. Can be AccessMode::ReadOnly or
+     * AccessMode::ReadWrite.
+     */
+    template <template <typename> class LockType, AccessMode Mode> class TryAccess : public Access<LockType, Mode>
+    {
+        using Base = Access<LockType, Mode>;
+
+      public:
+        using Base::Base;
+
+        /**
+         * @brief Whether the lock owns the mutex, and the TryAccess object can be dereferenced.
+         */
+        explicit operator bool() const noexcept
+        {
+            return this->lock.owns_lock();
+        }
+
+        typename Base::ConstPointerType operator->() const noexcept
+        {
+            assert(*this);
+            return Base::operator->();
+        }
+        typename Base::PointerType operator->() noexcept
+        {
+            assert(*this);
+            return Base::operator->();
+        }
+        typename Base::ConstReferenceType operator*() const noexcept
+        {
+            assert(*this);
+            return Base::operator*();
+        }
+        typename Base::ReferenceType operator*() noexcept
+        {
+            assert(*this);
+            return Base::operator*();
+        }
+    };
+
     /// Reference-to-const ValueType.
     using ConstValueReferenceType = const RemoveRefValueType &;
     /// Reference to ValueType.
@@ -194,6 +330,14 @@ template <typename ValueType, typename MutexType = std::mutex> class Safe
     using ReadAccess = Access<LockType, AccessMode::ReadOnly>;
     template <template <typename> class LockType = DefaultReadWriteLockType>
     using WriteAccess = Access<LockType, AccessMode::ReadWrite>;
+    /// Alias to the UpgradeAccess class for this Safe class.
+    template <template <typename> class LockType = UpgradeLock>
+    using UpgradeAccess = Access<LockType, AccessMode::Upgradeable>;
+    /// Aliases to TryReadAccess and TryWriteAccess classes for this Safe class.
+    template <template <typename> class LockType = DefaultTryReadOnlyLockType>
+    using TryReadAccess = TryAccess<LockType, AccessMode::ReadOnly>;
+    template <template <typename> class LockType = DefaultTryReadWriteLockType>
+    using TryWriteAccess = TryAccess<LockType, AccessMode::ReadWrite>;
 
     /**
      * @brief Construct a Safe object
@@ -281,6 +425,214 @@ template <typename ValueType, typename MutexType = std::mutex> class Safe
         return EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17{*this, std::forward<LockArgs>(lockArgs)...};
     }
 
+    /**
+     * @brief Try to lock the Safe object to get a TryReadAccess object, without blocking: convert it to bool to know
+     * whether the mutex was locked.
+     *
+     * With no argument, the mutex is tried once. With a safe::Backoff object, it is tried several times, spinning in
+     * between. With a duration or a time point, the thread waits for the mutex up to that time (the mutex must be
+     * timed, like std::timed_mutex).
+     *
+     * @tparam TryArgs Deduced from tryArgs.
+     * @param tryArgs Nothing, a safe::Backoff object, a std::chrono::duration or a std::chrono::time_point.
+     */
+    template <template <typename> class LockType = DefaultTryReadOnlyLockType, typename... TryArgs>
+    TryReadAccess<LockType> tryReadLock(const TryArgs &...tryArgs) const
+    {
+        TryReadAccess<LockType> access(*this, std::defer_lock);
+        impl::tryLock(access.lock, tryArgs...);
+        return access;
+    }
+
+    /**
+     * @brief Try to lock the Safe object to get a TryWriteAccess object, without blocking: convert it to bool to know
+     * whether the mutex was locked. Takes the same arguments as tryReadLock().
+     *
+     * @tparam TryArgs Deduced from tryArgs.
+     * @param tryArgs Nothing, a safe::Backoff object, a std::chrono::duration or a std::chrono::time_point.
+     */
+    template <template <typename> class LockType = DefaultTryReadWriteLockType, typename... TryArgs>
+    TryWriteAccess<LockType> tryWriteLock(const TryArgs &...tryArgs)
+    {
+        TryWriteAccess<LockType> access(*this, std::defer_lock);
+        impl::tryLock(access.lock, tryArgs...);
+        return access;
+    }
+
+    /**
+     * @brief Lock the Safe object in upgrade mode to get an UpgradeAccess object: read-only access that coexists with
+     * readers, excludes writers and other upgraders, and can be upgraded to a WriteAccess. The mutex must support
+     * upgrade locking, like safe::UpgradeMutex.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the lock object.
+     */
+    template <template <typename> class LockType = UpgradeLock, typename... LockArgs>
+    UpgradeAccess<LockType> upgradeLock(LockArgs &&...lockArgs)
+    {
+        using ReturnType = UpgradeAccess<LockType>;
+        return EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17{*this, std::forward<LockArgs>(lockArgs)...};
+    }
+
+    /**
+     * @brief Lock the Safe object and wait until a predicate on the value holds. The mutex must support waiting, like
+     * safe::NotifyingMutex: waiters are woken up when the mutex is unlocked, only if their predicate holds.
+     *
+     * @tparam Predicate Deduced from predicate.
+     * @param predicate Function called with a ConstValueReferenceType argument, returns true when the wait is over. If
+     * it throws, the exception is rethrown by this function, even if another thread called the predicate.
+     * @return WriteAccess<std::unique_lock> WriteAccess object to the value, for which the predicate holds.
+     */
+    template <typename Predicate> WriteAccess<std::unique_lock> waitUntil(Predicate &&predicate)
+    {
+        WriteAccess<std::unique_lock> access(*this);
+        auto check = [&]() -> bool { return predicate(static_cast<ConstValueReferenceType>(m_value)); };
+        m_mutex.get.wait(check);
+        return access;
+    }
+
+    /**
+     * @brief Lock the Safe object and wait until a predicate on the value holds, or until the timeout expires. The
+     * mutex must support waiting, like safe::NotifyingMutex.
+     *
+     * @tparam Predicate Deduced from predicate.
+     * @param predicate Function called with a ConstValueReferenceType argument, returns true when the wait is over.
+     * @param timeout Maximum time to wait.
+     * @return TryWriteAccess<std::unique_lock> TryWriteAccess object to the value: convert it to bool to know whether
+     * the predicate held before the timeout expired. It does not own the mutex otherwise.
+     */
+    template <typename Predicate, typename Rep, typename Period>
+    TryWriteAccess<std::unique_lock> waitFor(Predicate &&predicate, std::chrono::duration<Rep, Period> timeout)
+    {
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+        TryWriteAccess<std::unique_lock> access(*this);
+        auto check = [&]() -> bool { return predicate(static_cast<ConstValueReferenceType>(m_value)); };
+        if (!m_mutex.get.waitUntil(check, deadline))
+        {
+            access.lock.unlock();
+        }
+        return access;
+    }
+
+#if __cplusplus >= 202002L
+    /**
+     * @brief Lock the Safe object without blocking the thread: co_await safeValue.asyncReadLock() suspends the
+     * coroutine until the mutex is locked and gives a ReadAccess object. The mutex must have a lockAsync() function,
+     * like safe::AsyncMutex.
+     */
+    template <template <typename> class LockType = DefaultReadOnlyLockType> auto asyncReadLock() const
+    {
+        return impl::AsyncAccessAwaiter<ReadAccess<LockType>, const Safe, decltype(m_mutex.get.lockAsync())>(
+            *this, m_mutex.get.lockAsync());
+    }
+
+    /**
+     * @brief Lock the Safe object without blocking the thread: co_await safeValue.asyncWriteLock() suspends the
+     * coroutine until the mutex is locked and gives a WriteAccess object. The mutex must have a lockAsync() function,
+     * like safe::AsyncMutex.
+     */
+    template <template <typename> class LockType = DefaultReadWriteLockType> auto asyncWriteLock()
+    {
+        return impl::AsyncAccessAwaiter<WriteAccess<LockType>, Safe, decltype(m_mutex.get.lockAsync())>(
+            *this, m_mutex.get.lockAsync());
+    }
+#endif // __cplusplus >= 202002L
+
+    /**
+     * @brief Call a function with a const reference to the value, the mutex being locked with the default read-only
+     * lock type. If the mutex supports flat combining (like safe::CombiningMutex), the function may be called by the
+     * thread that holds the mutex.
+     *
+     * @tparam Function Deduced from function.
+     * @param function Function called with a ConstValueReferenceType argument.
+     */
+    template <typename Function> void apply(Function &&function) const
+    {
+        auto call = [&]() { function(static_cast<ConstValueReferenceType>(m_value)); };
+        impl::lockAndCall<DefaultReadOnlyLockType>(m_mutex.get, call, 0);
+    }
+    /**
+     * @brief Call a function with a reference to the value, the mutex being locked with the default read-write lock
+     * type. If the mutex supports flat combining (like safe::CombiningMutex), the function may be called by the thread
+     * that holds the mutex.
+     *
+     * @tparam Function Deduced from function.
+     * @param function Function called with a ValueReferenceType argument.
+     */
+    template <typename Function> void apply(Function &&function)
+    {
+        auto call = [&]() { function(static_cast<ValueReferenceType>(m_value)); };
+        impl::lockAndCall<DefaultReadWriteLockType>(m_mutex.get, call, 0);
+    }
+
+    /**
+     * @brief Copy the value out of the Safe object, the mutex being locked with the default read-only lock type only
+     * for the copy.
+     *
+     * @return RemoveRefValueType A copy of the value.
+     */
+    RemoveRefValueType load() const
+    {
+        const ReadAccess<> access(*this);
+        return *access;
+    }
+
+    /**
+     * @brief Replace the value and return the old one. The new value is constructed before locking the mutex and the
+     * old one is destroyed by the caller, after the mutex is unlocked: only a swap happens with the mutex locked.
+     *
+     * @tparam NewValue Deduced from newValue.
+     * @param newValue Perfect forwarding argument to construct the new value.
+     * @return RemoveRefValueType The old value.
+     */
+    template <typename NewValue> RemoveRefValueType exchange(NewValue &&newValue)
+    {
+        RemoveRefValueType value(std::forward<NewValue>(newValue));
+        {
+            WriteAccess<> access(*this);
+            using std::swap;
+            swap(*access, value);
+        }
+        return value;
+    }
+
+    /**
+     * @brief Move the value out of the Safe object, leaving a default-constructed value in its place. Only a swap
+     * happens with the mutex locked.
+     *
+     * @return RemoveRefValueType The value.
+     */
+    RemoveRefValueType take()
+    {
+        return exchange(RemoveRefValueType());
+    }
+
+    /**
+     * @brief Replace the value. The old value is destroyed after the mutex is unlocked, see exchange().
+     *
+     * @tparam NewValue Deduced from newValue.
+     * @param newValue Perfect forwarding argument to construct the new value.
+     */
+    template <typename NewValue> void store(NewValue &&newValue)
+    {
+        exchange(std::forward<NewValue>(newValue));
+    }
+
+    /**
+     * @brief Queue a function to be called with a reference to the value, without locking the mutex. The mutex must
+     * support posting, like safe::PostingMutex: the function is called by the next thread that locks the mutex, before
+     * it accesses the value.
+     *
+     * @tparam Function Deduced from function.
+     * @param function Function called with a ValueReferenceType argument, must not throw.
+     */
+    template <typename Function> void post(Function &&function)
+    {
+        using BoundFunction = impl::BoundFunction<typename std::decay<Function>::type, RemoveRefValueType>;
+        m_mutex.get.post(BoundFunction{std::forward<Function>(function), m_value});
+    }
+
     /**
      * @brief Unsafe const accessor to the value. If you use this function, you exit the realm of safe!
      *
@@ -350,6 +702,33 @@ using ReadAccess = typename SafeType::template ReadAccess<LockType>;
  */
 template <typename SafeType, template <typename> class LockType = DefaultReadWriteLockType>
 using WriteAccess = typename SafeType::template WriteAccess<LockType>;
+
+/**
+ * @brief Type alias for upgradeable Access.
+ *
+ * @tparam SafeType The type of Safe object to give upgradeable access to.
+ * @tparam LockType The type of lock.
+ */
+template <typename SafeType, template <typename> class LockType = UpgradeLock>
+using UpgradeAccess = typename SafeType::template UpgradeAccess<LockType>;
+
+/**
+ * @brief Type alias for read-only TryAccess.
+ *
+ * @tparam SafeType The type of Safe object to give read-only access to.
+ * @tparam LockType The type of lock.
+ */
+template <typename SafeType, template <typename> class LockType = DefaultTryReadOnlyLockType>
+using TryReadAccess = typename SafeType::template TryReadAccess<LockType>;
+
+/**
+ * @brief Type alias for read-write TryAccess.
+ *
+ * @tparam SafeType The type of Safe object to give read-write access to.
+ * @tparam LockType The type of lock.
+ */
+template <typename SafeType, template <typename> class LockType = DefaultTryReadWriteLockType>
+using TryWriteAccess = typename SafeType::template TryWriteAccess<LockType>;
 } // namespace safe
 
 #undef EXPLICIT_IF_CPP17
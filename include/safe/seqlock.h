@@ -0,0 +1,229 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "copying_safe.h"
+#include "safe.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace safe
+{
+/**
+ * @brief A sequence lock. Writers exclude each other like with a mutex and bump a sequence number before and after
+ * writing. Readers never write to the lock: they copy the value and retry if the sequence number changed in the
+ * meantime.
+ *
+ * The writer side meets the Lockable requirements, so any lock type can manage it. Use it as the MutexType of a Safe
+ * object to get the Safe<ValueType, SeqLock> specialization.
+ */
+class SeqLock
+{
+  public:
+    SeqLock() = default;
+    SeqLock(const SeqLock &) = delete;
+    SeqLock &operator=(const SeqLock &) = delete;
+
+    void lock() noexcept
+    {
+        for (std::size_t sequence = m_sequence.load(std::memory_order_relaxed);;
+             sequence = m_sequence.load(std::memory_order_relaxed))
+        {
+            if (sequence % 2 == 0 && m_sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire,
+                                                                      std::memory_order_relaxed))
+            {
+                break;
+            }
+            std::this_thread::yield();
+        }
+        // Keep the writes to the value from becoming visible before the sequence number is odd.
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    bool try_lock() noexcept
+    {
+        std::size_t sequence = m_sequence.load(std::memory_order_relaxed);
+        if (sequence % 2 != 0 ||
+            !m_sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire,
+                                                std::memory_order_relaxed))
+        {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        return true;
+    }
+
+    void unlock() noexcept
+    {
+        m_sequence.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Start an optimistic read: wait until no writer holds the lock.
+     *
+     * @return The sequence number to pass to validateRead().
+     */
+    std::size_t beginRead() const noexcept
+    {
+        std::size_t sequence = m_sequence.load(std::memory_order_acquire);
+        while (sequence % 2 != 0)
+        {
+            std::this_thread::yield();
+            sequence = m_sequence.load(std::memory_order_acquire);
+        }
+        return sequence;
+    }
+
+    /**
+     * @brief Start an optimistic read without waiting.
+     *
+     * @param sequence Set to the sequence number to pass to validateRead().
+     * @return false if a writer holds the lock.
+     */
+    bool tryBeginRead(std::size_t &sequence) const noexcept
+    {
+        sequence = m_sequence.load(std::memory_order_acquire);
+        return sequence % 2 == 0;
+    }
+
+    /**
+     * @brief End an optimistic read.
+     *
+     * @param sequence The value returned by beginRead().
+     * @return true if no writer took the lock since beginRead(), meaning the data read in between is consistent.
+     */
+    bool validateRead(std::size_t sequence) const noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return m_sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+  private:
+    std::atomic<std::size_t> m_sequence{0};
+};
+
+namespace impl
+{
+/**
+ * @brief Storage for the value of a Safe<ValueType, SeqLock> object: an array of atomic words. Readers copy the value
+ * while a writer may be storing to it, so both sides access it with relaxed atomic operations, word by word, and the
+ * SeqLock's fences order them.
+ *
+ * @tparam ValueType The type of the value, must be trivially copyable.
+ */
+template <typename ValueType> class SeqLockStorage
+{
+    using Word = std::uintptr_t;
+    static constexpr std::size_t wordCount = (sizeof(ValueType) + sizeof(Word) - 1) / sizeof(Word);
+
+  public:
+    explicit SeqLockStorage(const ValueType &value) noexcept
+    {
+        storeLocked(value);
+    }
+
+    /**
+     * @brief Copy the value out of the words, retrying until no writer interfered with the copy.
+     */
+    ValueType load(const SeqLock &seqLock) const noexcept
+    {
+        while (true)
+        {
+            const std::size_t sequence = seqLock.beginRead();
+            // The copy is torn if a writer stored the value meanwhile, in which case it is discarded: validateRead()
+            // tells.
+            const ValueType copy(loadLocked());
+            if (seqLock.validateRead(sequence))
+            {
+                return copy;
+            }
+        }
+    }
+
+    /**
+     * @brief Copy the value out of the words once, without waiting for writers.
+     *
+     * @return false if a writer held the SeqLock or interfered with the copy, in which case value is unchanged.
+     */
+    bool tryLoad(const SeqLock &seqLock, ValueType &value) const noexcept
+    {
+        std::size_t sequence;
+        if (!seqLock.tryBeginRead(sequence))
+        {
+            return false;
+        }
+        const ValueType copy(loadLocked());
+        if (!seqLock.validateRead(sequence))
+        {
+            return false;
+        }
+        value = copy;
+        return true;
+    }
+
+    /**
+     * @brief Copy the value out of the words. The copy is torn if a writer stores concurrently: readers call load()
+     * instead.
+     */
+    ValueType loadLocked() const noexcept
+    {
+        Word words[wordCount];
+        for (std::size_t index = 0; index < wordCount; ++index)
+        {
+            words[index] = m_words[index].load(std::memory_order_relaxed);
+        }
+        alignas(ValueType) unsigned char bytes[sizeof(ValueType)];
+        std::memcpy(bytes, words, sizeof(ValueType));
+        return *reinterpret_cast<const ValueType *>(bytes);
+    }
+
+    /**
+     * @brief Copy a value into the words. Must be called with the SeqLock locked.
+     */
+    void storeLocked(const ValueType &value) noexcept
+    {
+        Word words[wordCount] = {};
+        std::memcpy(words, &value, sizeof(ValueType));
+        for (std::size_t index = 0; index < wordCount; ++index)
+        {
+            m_words[index].store(words[index], std::memory_order_relaxed);
+        }
+    }
+
+  private:
+    std::atomic<Word> m_words[wordCount];
+};
+} // namespace impl
+
+/**
+ * @brief Specialization of Safe for sequence locks.
+ *
+ * Read accesses hold a consistent copy of the value and do not lock anything: readers never write to shared memory,
+ * so they do not slow each other down. Write accesses lock the SeqLock, give access to a copy of the value and store
+ * it back when destroyed, like with AtomicPolicy.
+ *
+ * The value is stored as an array of atomic words, copied word by word with relaxed atomic operations on both sides:
+ * readers may copy it while a writer stores it back, without a data race. Torn copies are discarded and retried.
+ *
+ * @tparam ValueType The type of the value to protect, must be trivially copyable.
+ */
+template <typename ValueType>
+class Safe<ValueType, SeqLock> : public impl::CopyingSafe<ValueType, SeqLock, impl::SeqLockStorage<ValueType>>
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value,
+                  "Safe<ValueType, SeqLock> requires a trivially copyable ValueType.");
+
+  public:
+    using impl::CopyingSafe<ValueType, SeqLock, impl::SeqLockStorage<ValueType>>::CopyingSafe;
+};
+} // namespace safe
@@ -0,0 +1,203 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "cache_line.h"
+#include "meta.h"
+#include "safe.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#if __cplusplus >= 201703L
+#define EXPLICIT_IF_CPP17 explicit
+#define EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17 ReturnType
+#else
+#define EXPLICIT_IF_CPP17
+#define EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17
+#endif
+
+namespace safe
+{
+/**
+ * @brief Splits a keyed container (e.g. std::unordered_map) into ShardCount Safe objects, to reduce contention. Each
+ * key belongs to one shard, chosen from the hash of the key. Each shard is on its own cache lines.
+ *
+ * @tparam Container The type of container to shard, must define key_type.
+ * @tparam ShardCount The number of shards.
+ * @tparam MutexType The type of the mutex of each shard.
+ * @tparam Hash The type of hash function used to pick the shard of a key.
+ */
+template <typename Container, std::size_t ShardCount, typename MutexType = std::mutex,
+          typename Hash = std::hash<typename Container::key_type>>
+class ShardedSafe
+{
+    static_assert(ShardCount != 0, "ShardedSafe needs at least one shard.");
+
+  public:
+    /// The type of the Safe objects that hold the shards.
+    using ShardType = Safe<Container, MutexType>;
+    /// The type of the keys.
+    using KeyType = typename Container::key_type;
+
+    /// Aliases to ReadAccess and WriteAccess classes of the shards.
+    template <template <typename> class LockType = DefaultReadOnlyLockType>
+    using ReadAccess = typename ShardType::template ReadAccess<LockType>;
+    template <template <typename> class LockType = DefaultReadWriteLockType>
+    using WriteAccess = typename ShardType::template WriteAccess<LockType>;
+
+    /// The number of shards.
+    static constexpr std::size_t shardCount = ShardCount;
+
+    ShardedSafe() = default;
+
+    /// Delete all copy/move construction/assignment, as these operations require locking the mutexes under the covers.
+    ShardedSafe(const ShardedSafe &) = delete;
+    ShardedSafe(ShardedSafe &&) = delete;
+    ShardedSafe &operator=(const ShardedSafe &) = delete;
+    ShardedSafe &operator=(ShardedSafe &&) = delete;
+
+    /**
+     * @brief Lock the shard of a key to get a ReadAccess object.
+     *
+     * @tparam LockArgs Deduced from lockArgs.
+     * @param key The key whose shard to lock.
+     * @param lockArgs Perfect forwarding arguments to construct the lock object.
+     */
+    template <template <typename> class LockType = DefaultReadOnlyLockType, typename... LockArgs>
+    ReadAccess<LockType> readLock(const KeyType &key, LockArgs &&...lockArgs) const
+    {
+        using ReturnType = ReadAccess<LockType>;
+        return EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17{shardFor(key), std::forward<LockArgs>(lockArgs)...};
+    }
+
+    /**
+     * @brief Lock the shard of a key to get a WriteAccess object.
+     *
+     * @tparam LockArgs Deduced from lockArgs.
+     * @param key The key whose shard to lock.
+     * @param lockArgs Perfect forwarding arguments to construct the lock object.
+     */
+    template <template <typename> class LockType = DefaultReadWriteLockType, typename... LockArgs>
+    WriteAccess<LockType> writeLock(const KeyType &key, LockArgs &&...lockArgs)
+    {
+        using ReturnType = WriteAccess<LockType>;
+        return EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17{shardFor(key), std::forward<LockArgs>(lockArgs)...};
+    }
+
+    /**
+     * @brief Index of the shard a key belongs to.
+     */
+    static std::size_t shardIndex(const KeyType &key)
+    {
+        // Mix the bits of the hash: many standard hash functions are the identity for integers.
+        std::uint64_t hash = static_cast<std::uint64_t>(Hash()(key));
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        return static_cast<std::size_t>(hash % ShardCount);
+    }
+
+    /**
+     * @brief Accessor to the shard a key belongs to. Throws what Hash throws.
+     */
+    ShardType &shardFor(const KeyType &key)
+    {
+        return m_shards[shardIndex(key)];
+    }
+    const ShardType &shardFor(const KeyType &key) const
+    {
+        return m_shards[shardIndex(key)];
+    }
+
+    /**
+     * @brief Accessor to a shard by index.
+     */
+    ShardType &shard(std::size_t index) noexcept
+    {
+        return m_shards[index];
+    }
+    const ShardType &shard(std::size_t index) const noexcept
+    {
+        return m_shards[index];
+    }
+
+    /**
+     * @brief Visit the shards one after the other, each one being locked only while it is visited. Modifications
+     * made to other shards during the visit may or may not be seen.
+     *
+     * @tparam Function Deduced from function.
+     * @param function Function called with a reference to each container.
+     */
+    template <typename Function> void forEachShard(Function &&function)
+    {
+        for (auto &shard : m_shards)
+        {
+            WriteAccess<> container(shard);
+            function(*container);
+        }
+    }
+    template <typename Function> void forEachShard(Function &&function) const
+    {
+        for (const auto &shard : m_shards)
+        {
+            ReadAccess<> container(shard);
+            function(*container);
+        }
+    }
+
+    /**
+     * @brief Lock all the shards, in index order, then visit them: the visit sees a consistent state of the whole
+     * container.
+     *
+     * Every function that locks several shards locks them in index order, so visitAll() cannot deadlock and, unlike
+     * lockAll(), never backs off: it waits for each shard in turn.
+     *
+     * @tparam Function Deduced from function.
+     * @param function Function called with a reference to each container.
+     */
+    template <typename Function> void visitAll(Function &&function)
+    {
+        visitAll<WriteAccess<DefaultTryReadWriteLockType>>(*this, function);
+    }
+    template <typename Function> void visitAll(Function &&function) const
+    {
+        visitAll<ReadAccess<DefaultTryReadOnlyLockType>>(*this, function);
+    }
+
+  private:
+    /// AccessType must be movable to be stored in a std::vector: the Try lock types are the movable default lock types.
+    template <typename AccessType, typename Self, typename Function>
+    static void visitAll(Self &self, Function &function)
+    {
+        std::vector<AccessType> accesses;
+        accesses.reserve(ShardCount);
+        for (auto &shard : self.m_shards)
+        {
+            accesses.emplace_back(shard);
+        }
+        for (auto &access : accesses)
+        {
+            function(*access);
+        }
+    }
+
+    /// The shards, aligned and padded to cache lines so that neighbouring shards never share a cache line.
+    Aligned<ShardType> m_shards[ShardCount];
+};
+
+template <typename Container, std::size_t ShardCount, typename MutexType, typename Hash>
+constexpr std::size_t ShardedSafe<Container, ShardCount, MutexType, Hash>::shardCount;
+} // namespace safe
+
+#undef EXPLICIT_IF_CPP17
+#undef EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17
@@ -0,0 +1,160 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "cache_line.h"
+#include "safe.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace safe
+{
+/**
+ * @brief A fixed set of mutexes shared by any number of values: each value is assigned a mutex (a stripe) by hashing
+ * its address or a key, and is wrapped in a Safe object that refers to the value and to the mutex. Memory stays
+ * proportional to the number of stripes, and values that do not share a stripe can be locked concurrently.
+ *
+ * Two handles that may share a stripe are locked together with lockBoth(), which locks a shared stripe only once.
+ * safe::lockAll() cannot do that: it throws std::logic_error if it is given handles that share a mutex.
+ *
+ * @tparam StripeCount The number of mutexes.
+ * @tparam MutexType The type of the mutexes.
+ */
+template <std::size_t StripeCount, typename MutexType = std::mutex> class StripedPool
+{
+    static_assert(StripeCount != 0, "A StripedPool needs at least one stripe.");
+
+  public:
+    /// Safe object that refers to a value and to the mutex of its stripe.
+    template <typename ValueType> using Handle = Safe<ValueType &, MutexType &>;
+
+    /**
+     * @brief Gives access to the values of two handles and keeps their stripes locked, whether they share a stripe or
+     * not.
+     *
+     * @tparam FirstValueType The type of the first value.
+     * @tparam SecondValueType The type of the second value.
+     */
+    template <typename FirstValueType, typename SecondValueType> class PairAccess
+    {
+      public:
+        /**
+         * @brief Lock the stripes of both handles without deadlocking. A stripe shared by both handles is locked once.
+         *
+         * @param firstHandle The first handle.
+         * @param secondHandle The second handle.
+         */
+        PairAccess(Handle<FirstValueType> &firstHandle, Handle<SecondValueType> &secondHandle)
+            : first(firstHandle.unsafe()), second(secondHandle.unsafe()),
+              m_firstLock(firstHandle.mutex(), std::defer_lock), m_secondLock(secondHandle.mutex(), std::defer_lock)
+        {
+            if (m_firstLock.mutex() == m_secondLock.mutex())
+            {
+                m_firstLock.lock();
+            }
+            else
+            {
+                std::lock(m_firstLock, m_secondLock);
+            }
+        }
+
+        /// Reference to the first value.
+        FirstValueType &first;
+        /// Reference to the second value.
+        SecondValueType &second;
+
+      private:
+        std::unique_lock<MutexType> m_firstLock;
+        /// Does not own its mutex if it is the mutex of m_firstLock.
+        std::unique_lock<MutexType> m_secondLock;
+    };
+
+    StripedPool() = default;
+    StripedPool(const StripedPool &) = delete;
+    StripedPool &operator=(const StripedPool &) = delete;
+
+    /**
+     * @brief The mutex of the stripe an address belongs to.
+     *
+     * @param address The address of the value.
+     * @return MutexType& Reference to the mutex.
+     */
+    MutexType &mutexFor(const void *address) const noexcept
+    {
+        return stripe(reinterpret_cast<std::uintptr_t>(address));
+    }
+
+    /**
+     * @brief The mutex of the stripe a key belongs to, hashed with std::hash.
+     *
+     * @tparam KeyType Deduced from key.
+     * @param key The key of the value.
+     * @return MutexType& Reference to the mutex.
+     */
+    template <typename KeyType> MutexType &mutexForKey(const KeyType &key) const
+    {
+        return stripe(std::hash<KeyType>()(key));
+    }
+
+    /**
+     * @brief Lock two handles of this pool together, even if they share a stripe.
+     *
+     * @tparam FirstValueType Deduced from first.
+     * @tparam SecondValueType Deduced from second.
+     * @param first The first handle.
+     * @param second The second handle.
+     * @return PairAccess<FirstValueType, SecondValueType> Access to both values.
+     */
+    template <typename FirstValueType, typename SecondValueType>
+    PairAccess<FirstValueType, SecondValueType> lockBoth(Handle<FirstValueType> &first,
+                                                         Handle<SecondValueType> &second) const
+    {
+        return PairAccess<FirstValueType, SecondValueType>(first, second);
+    }
+
+#if __cplusplus >= 201703L
+    /**
+     * @brief Wrap a value in a Safe object that uses the mutex of the value's stripe, chosen by address.
+     *
+     * @tparam ValueType Deduced from value.
+     * @param value The value, must outlive the handle.
+     * @return Handle<ValueType> Safe object that refers to the value.
+     */
+    template <typename ValueType> Handle<ValueType> bind(ValueType &value) const
+    {
+        return Handle<ValueType>(value, mutexFor(&value));
+    }
+
+    /**
+     * @brief Wrap a value in a Safe object that uses the mutex of a key's stripe.
+     *
+     * @tparam ValueType Deduced from value.
+     * @tparam KeyType Deduced from key.
+     * @param value The value, must outlive the handle.
+     * @param key The key of the value.
+     * @return Handle<ValueType> Safe object that refers to the value.
+     */
+    template <typename ValueType, typename KeyType> Handle<ValueType> bind(ValueType &value, const KeyType &key) const
+    {
+        return Handle<ValueType>(value, mutexForKey(key));
+    }
+#endif // __cplusplus >= 201703L
+
+  private:
+    MutexType &stripe(std::uint64_t hash) const noexcept
+    {
+        return m_mutexes[impl::slotIndex(hash, StripeCount)];
+    }
+
+    /// The mutexes, each alone on its cache line. Mutable because locking is not a modification of the pool.
+    mutable PaddedMutex<MutexType> m_mutexes[StripeCount];
+};
+} // namespace safe
@@ -0,0 +1,208 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "access_mode.h"
+
+#include <mutex>
+#if __cplusplus >= 201402L
+#include <shared_mutex>
+#endif // __cplusplus >= 201402L
+
+namespace safe
+{
+/**
+ * @brief Lock object that manages a mutex in upgrade mode: it shares the mutex with readers, but excludes writers and
+ * other upgraders. The mutex must have the lock_upgrade(), try_lock_upgrade() and unlock_upgrade() member functions,
+ * like safe::UpgradeMutex.
+ *
+ * @tparam MutexType The type of the mutex.
+ */
+template <typename MutexType> class UpgradeLock
+{
+  public:
+    using mutex_type = MutexType;
+
+    explicit UpgradeLock(MutexType &mutex) : m_mutex(&mutex), m_owns(false)
+    {
+        lock();
+    }
+    UpgradeLock(MutexType &mutex, std::defer_lock_t) noexcept : m_mutex(&mutex), m_owns(false)
+    {
+    }
+    UpgradeLock(MutexType &mutex, std::try_to_lock_t) : m_mutex(&mutex), m_owns(mutex.try_lock_upgrade())
+    {
+    }
+    UpgradeLock(MutexType &mutex, std::adopt_lock_t) noexcept : m_mutex(&mutex), m_owns(true)
+    {
+    }
+
+    UpgradeLock(UpgradeLock &&other) noexcept : m_mutex(other.m_mutex), m_owns(other.m_owns)
+    {
+        other.m_mutex = nullptr;
+        other.m_owns = false;
+    }
+    UpgradeLock(const UpgradeLock &) = delete;
+    UpgradeLock &operator=(const UpgradeLock &) = delete;
+    UpgradeLock &operator=(UpgradeLock &&) = delete;
+
+    ~UpgradeLock()
+    {
+        if (m_owns)
+        {
+            m_mutex->unlock_upgrade();
+        }
+    }
+
+    void lock()
+    {
+        m_mutex->lock_upgrade();
+        m_owns = true;
+    }
+    bool try_lock()
+    {
+        m_owns = m_mutex->try_lock_upgrade();
+        return m_owns;
+    }
+    void unlock()
+    {
+        m_mutex->unlock_upgrade();
+        m_owns = false;
+    }
+
+    /**
+     * @brief Disassociate the mutex without unlocking it.
+     *
+     * @return MutexType* Pointer to the mutex.
+     */
+    MutexType *release() noexcept
+    {
+        MutexType *mutex = m_mutex;
+        m_mutex = nullptr;
+        m_owns = false;
+        return mutex;
+    }
+
+    MutexType *mutex() const noexcept
+    {
+        return m_mutex;
+    }
+    bool owns_lock() const noexcept
+    {
+        return m_owns;
+    }
+    explicit operator bool() const noexcept
+    {
+        return m_owns;
+    }
+
+  private:
+    MutexType *m_mutex;
+    bool m_owns;
+};
+
+// Partial specialization for UpgradeLock: read only, until upgraded.
+template <typename MutexType> struct AccessTraits<UpgradeLock<MutexType>>
+{
+    static constexpr bool IsReadOnly = true;
+};
+
+#if __cplusplus >= 201402L
+/**
+ * @brief Shared mutex with an upgrade mode. Any number of readers (lock_shared()) can share the mutex with at most one
+ * upgrader (lock_upgrade()). Writers (lock()) exclude everyone. The upgrader can become a writer without letting any
+ * other writer or upgrader in (unlock_upgrade_and_lock()): what it read under the upgrade lock stays true.
+ */
+class UpgradeMutex
+{
+  public:
+    void lock()
+    {
+        m_upgrade.lock();
+        m_shared.lock();
+    }
+    bool try_lock()
+    {
+        if (!m_upgrade.try_lock())
+        {
+            return false;
+        }
+        if (!m_shared.try_lock())
+        {
+            m_upgrade.unlock();
+            return false;
+        }
+        return true;
+    }
+    void unlock()
+    {
+        m_shared.unlock();
+        m_upgrade.unlock();
+    }
+
+    void lock_shared()
+    {
+        m_shared.lock_shared();
+    }
+    bool try_lock_shared()
+    {
+        return m_shared.try_lock_shared();
+    }
+    void unlock_shared()
+    {
+        m_shared.unlock_shared();
+    }
+
+    void lock_upgrade()
+    {
+        m_upgrade.lock();
+        m_shared.lock_shared();
+    }
+    bool try_lock_upgrade()
+    {
+        if (!m_upgrade.try_lock())
+        {
+            return false;
+        }
+        if (!m_shared.try_lock_shared())
+        {
+            m_upgrade.unlock();
+            return false;
+        }
+        return true;
+    }
+    void unlock_upgrade()
+    {
+        m_shared.unlock_shared();
+        m_upgrade.unlock();
+    }
+
+    /**
+     * @brief Turn the upgrade lock into an exclusive lock. Waits for the readers to leave, but no writer or upgrader
+     * can come in meanwhile.
+     */
+    void unlock_upgrade_and_lock()
+    {
+        m_shared.unlock_shared();
+        m_shared.lock();
+    }
+
+  private:
+#if __cplusplus >= 201703L
+    using SharedMutex = std::shared_mutex;
+#else
+    using SharedMutex = std::shared_timed_mutex;
+#endif // __cplusplus >= 201703L
+
+    /// Held by the upgrader and by writers.
+    std::mutex m_upgrade;
+    /// Shared by readers and the upgrader, held exclusively by writers.
+    SharedMutex m_shared;
+};
+#endif // __cplusplus >= 201402L
+} // namespace safe
@@ -0,0 +1,241 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#pragma once
+
+#include "meta.h"
+#include "safe.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 201703L
+#define EXPLICIT_IF_CPP17 explicit
+#define EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17 ReturnType
+#else
+#define EXPLICIT_IF_CPP17
+#define EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17
+#endif
+
+namespace safe
+{
+/**
+ * @brief Safe object with a version number that every write access increments. Expensive updates can be computed on a
+ * copy of the value without holding the mutex, and committed only if no other write happened meanwhile: see update().
+ * Pollers can skip reading a value they have already seen: see readIfChanged().
+ *
+ * @tparam ValueType The type of the value to protect.
+ * @tparam MutexType The type of the mutex.
+ */
+template <typename ValueType, typename MutexType = std::mutex> class VersionedSafe
+{
+    /// The Safe object that holds the value and the mutex.
+    using SafeType = Safe<ValueType, MutexType>;
+    /// Type ValueType with reference removed, if present
+    using RemoveRefValueType = typename std::remove_reference<ValueType>::type;
+    /// Type MutexType with reference removed, if present
+    using RemoveRefMutexType = typename std::remove_reference<MutexType>::type;
+
+    /**
+     * @brief WriteAccess of the underlying Safe object that increments the version when it is destroyed, if its lock
+     * owns the mutex.
+     *
+     * @tparam LockType The type of the lock object that manages the mutex, example: std::lock_guard.
+     */
+    template <template <typename> class LockType> class Access : public SafeType::template WriteAccess<LockType>
+    {
+        using Base = typename SafeType::template WriteAccess<LockType>;
+
+      public:
+        /**
+         * @brief Construct an Access object from a VersionedSafe object and any additionnal argument needed to
+         * construct the Lock object.
+         *
+         * @tparam OtherLockArgs Deduced from otherLockArgs.
+         * @param safe The VersionedSafe object to give protected access to.
+         * @param otherLockArgs Other arguments needed to construct the lock object.
+         */
+        template <typename... OtherLockArgs>
+        EXPLICIT_IF_CPP17 Access(VersionedSafe &safe, OtherLockArgs &&...otherLockArgs)
+            : Base(safe.m_safe, std::forward<OtherLockArgs>(otherLockArgs)...), m_version(safe.m_version)
+        {
+        }
+        Access(Access &&) = default;
+        Access &operator=(Access &&) = delete;
+
+        /**
+         * @brief Increment the version before the mutex is unlocked.
+         */
+        ~Access()
+        {
+            if (impl::ownsLock(this->lock, 0))
+            {
+                m_version.store(m_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+        }
+
+      private:
+        std::atomic<std::uint64_t> &m_version;
+    };
+
+  public:
+    /// Aliases to ReadAccess and WriteAccess classes for this VersionedSafe class.
+    template <template <typename> class LockType = DefaultReadOnlyLockType>
+    using ReadAccess = typename SafeType::template ReadAccess<LockType>;
+    template <template <typename> class LockType = DefaultReadWriteLockType> using WriteAccess = Access<LockType>;
+    /// Alias to the TryReadAccess class readIfChanged() returns.
+    template <template <typename> class LockType = DefaultTryReadOnlyLockType>
+    using TryReadAccess = typename SafeType::template TryReadAccess<LockType>;
+
+    /**
+     * @brief Construct a VersionedSafe object, forwarding all arguments to the constructor of Safe.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the value object and the mutex.
+     */
+    template <typename... Args> explicit VersionedSafe(Args &&...args) : m_safe(std::forward<Args>(args)...)
+    {
+    }
+
+    /// Delete all copy/move construction/assignment, as these operations require locking the mutex under the covers.
+    VersionedSafe(const VersionedSafe &) = delete;
+    VersionedSafe(VersionedSafe &&) = delete;
+    VersionedSafe &operator=(const VersionedSafe &) = delete;
+    VersionedSafe &operator=(VersionedSafe &&) = delete;
+
+    /**
+     * @brief Lock the VersionedSafe object to get a ReadAccess object.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the lock object.
+     */
+    template <template <typename> class LockType = DefaultReadOnlyLockType, typename... LockArgs>
+    ReadAccess<LockType> readLock(LockArgs &&...lockArgs) const
+    {
+        using ReturnType = ReadAccess<LockType>;
+        return EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17{m_safe, std::forward<LockArgs>(lockArgs)...};
+    }
+
+    /**
+     * @brief Lock the VersionedSafe object to get a WriteAccess object, which increments the version when it is
+     * destroyed.
+     *
+     * @tparam Args Deduced from args.
+     * @param args Perfect forwarding arguments to construct the lock object.
+     */
+    template <template <typename> class LockType = DefaultReadWriteLockType, typename... LockArgs>
+    WriteAccess<LockType> writeLock(LockArgs &&...lockArgs)
+    {
+        using ReturnType = WriteAccess<LockType>;
+        return EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17{*this, std::forward<LockArgs>(lockArgs)...};
+    }
+
+    /**
+     * @brief Lock the VersionedSafe object only if its version differs from lastVersion, and update lastVersion.
+     *
+     * @param lastVersion The version of the value the caller last read, updated if the mutex is locked.
+     * @return TryReadAccess<> Access object that converts to true only if the version changed.
+     */
+    template <template <typename> class LockType = DefaultTryReadOnlyLockType>
+    TryReadAccess<LockType> readIfChanged(std::uint64_t &lastVersion) const
+    {
+        TryReadAccess<LockType> access(m_safe, std::defer_lock);
+        if (m_version.load(std::memory_order_acquire) != lastVersion)
+        {
+            access.lock.lock();
+            lastVersion = m_version.load(std::memory_order_relaxed);
+        }
+        return access;
+    }
+
+    /**
+     * @brief Update the value with a function that can take a long time, without holding the mutex while it runs.
+     *
+     * The value is copied with the mutex locked for reading, the function modifies the copy with the mutex unlocked,
+     * and the copy replaces the value only if the version did not change meanwhile. Otherwise, the update starts over.
+     * After optimisticAttempts failed attempts, the function is called on the value itself, with the mutex locked for
+     * writing. The function must be callable several times.
+     *
+     * @tparam Function Deduced from function.
+     * @param function Function that modifies the value it is given a reference to.
+     * @param optimisticAttempts The number of attempts without holding the mutex.
+     * @return true if the update was done without holding the mutex, false if it fell back to locking it.
+     */
+    template <typename Function> bool update(Function &&function, unsigned optimisticAttempts = 3)
+    {
+        for (unsigned attempt = 0; attempt < optimisticAttempts; ++attempt)
+        {
+            std::uint64_t version;
+            RemoveRefValueType value = snapshot(version);
+            function(value);
+            {
+                // Not a WriteAccess: the version is only incremented if the copy is committed.
+                typename SafeType::template WriteAccess<> access(m_safe);
+                if (m_version.load(std::memory_order_relaxed) == version)
+                {
+                    // The old value is destroyed after the mutex is unlocked.
+                    using std::swap;
+                    swap(*access, value);
+                    m_version.store(version + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+        }
+
+        WriteAccess<> access(*this);
+        function(*access);
+        return false;
+    }
+
+    /**
+     * @brief The number of write accesses so far. Can be called without locking the mutex.
+     */
+    std::uint64_t version() const noexcept
+    {
+        return m_version.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Unsafe const accessor to the value. If you use this function, you exit the realm of safe!
+     */
+    const RemoveRefValueType &unsafe() const noexcept
+    {
+        return m_safe.unsafe();
+    }
+
+    /**
+     * @brief Accessor to the mutex.
+     *
+     * @return RemoveRefMutexType& Reference to the mutex.
+     */
+    RemoveRefMutexType &mutex() const noexcept
+    {
+        return m_safe.mutex();
+    }
+
+  private:
+    /**
+     * @brief Copy the value and its version, with the mutex locked for reading.
+     */
+    RemoveRefValueType snapshot(std::uint64_t &version) const
+    {
+        ReadAccess<> access(m_safe);
+        version = m_version.load(std::memory_order_relaxed);
+        return *access;
+    }
+
+    SafeType m_safe;
+    /// Only modified with the mutex locked.
+    std::atomic<std::uint64_t> m_version{0};
+};
+} // namespace safe
+
+#undef EXPLICIT_IF_CPP17
+#undef EXPLICITLY_CONSTRUCT_RETURN_TYPE_IF_CPP17
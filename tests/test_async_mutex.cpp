@@ -0,0 +1,329 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/async_mutex.h"
+#include "safe/safe.h"
+
+#include <doctest/doctest.h>
+
+#if __cplusplus >= 202002L
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+/**
+ * @brief Minimal thread pool that runs coroutines.
+ */
+class Executor
+{
+  public:
+    explicit Executor(unsigned threadCount)
+    {
+        for (unsigned index = 0; index < threadCount; ++index)
+        {
+            m_threads.emplace_back([this]() { work(); });
+        }
+    }
+    ~Executor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        for (auto &thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    /// Whether the calling thread is one of the executor's threads.
+    bool runsOnThisThread() const
+    {
+        for (const auto &thread : m_threads)
+        {
+            if (thread.get_id() == std::this_thread::get_id())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// co_await executor.schedule() resumes the coroutine on one of the executor's threads.
+    auto schedule()
+    {
+        struct Awaiter
+        {
+            Executor &executor;
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                executor.post(handle);
+            }
+            void await_resume() const noexcept
+            {
+            }
+        };
+        return Awaiter{*this};
+    }
+
+    void post(std::coroutine_handle<> handle)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(handle);
+        }
+        m_condition.notify_one();
+    }
+
+  private:
+    void work()
+    {
+        while (true)
+        {
+            std::coroutine_handle<> handle;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+                if (m_queue.empty())
+                {
+                    return;
+                }
+                handle = m_queue.front();
+                m_queue.pop_front();
+            }
+            handle.resume();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::coroutine_handle<>> m_queue;
+    bool m_stop = false;
+    std::vector<std::thread> m_threads;
+};
+
+/**
+ * @brief Fire-and-forget coroutine.
+ */
+struct Task
+{
+    struct promise_type
+    {
+        Task get_return_object() noexcept
+        {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_void() noexcept
+        {
+        }
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+/**
+ * @brief Counts down finished tasks.
+ */
+class Latch
+{
+  public:
+    explicit Latch(int count) : m_count(count)
+    {
+    }
+    void countDown()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_count == 0)
+        {
+            m_condition.notify_all();
+        }
+    }
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_count == 0; });
+    }
+
+  private:
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    int m_count;
+};
+} // namespace
+
+TEST_CASE("asyncWriteLock gives a WriteAccess object")
+{
+    safe::Safe<int, safe::AsyncMutex> safeValue(42);
+    Latch done(1);
+
+    [](safe::Safe<int, safe::AsyncMutex> &safeValue, Latch &done) -> Task {
+        {
+            auto value = co_await safeValue.asyncWriteLock();
+            static_assert(!std::is_const<std::remove_reference_t<decltype(*value)>>::value);
+            ++*value;
+        }
+        {
+            const auto value = co_await std::as_const(safeValue).asyncReadLock();
+            static_assert(std::is_const<std::remove_reference_t<decltype(*value)>>::value);
+        }
+        done.countDown();
+    }(safeValue, done);
+
+    done.wait();
+    CHECK_EQ(*safeValue.readLock(), 43);
+    CHECK(safeValue.mutex().try_lock());
+    safeValue.mutex().unlock();
+}
+
+TEST_CASE("AsyncMutex suspends coroutines instead of blocking their thread")
+{
+    safe::Safe<int, safe::AsyncMutex> safeValue(0);
+    Latch done(1);
+    std::atomic<bool> resumed{false};
+    {
+        auto value = safeValue.writeLock();
+        [](safe::Safe<int, safe::AsyncMutex> &safeValue, std::atomic<bool> &resumed, Latch &done) -> Task {
+            auto value = co_await safeValue.asyncWriteLock();
+            resumed.store(true);
+            ++*value;
+            done.countDown();
+        }(safeValue, resumed, done);
+        // The coroutine is suspended: this thread goes on.
+        CHECK_FALSE(resumed.load());
+        ++*value;
+    }
+    // Unlocking resumed the coroutine.
+    CHECK(resumed.load());
+    done.wait();
+    CHECK_EQ(*safeValue.readLock(), 2);
+}
+
+TEST_CASE("Coroutines can hold an AsyncMutex across suspension points")
+{
+    constexpr int taskCount = 50;
+    constexpr int incrementCount = 20;
+    safe::Safe<int, safe::AsyncMutex> safeValue(0);
+    Latch done(taskCount);
+    {
+        Executor executor(2);
+        for (int task = 0; task < taskCount; ++task)
+        {
+            [](safe::Safe<int, safe::AsyncMutex> &safeValue, Executor &executor, Latch &done) -> Task {
+                co_await executor.schedule();
+                for (int i = 0; i < incrementCount; ++i)
+                {
+                    auto value = co_await safeValue.asyncWriteLock();
+                    const int before = *value;
+                    // Other coroutines run on this thread meanwhile, but cannot modify the value.
+                    co_await executor.schedule();
+                    *value = before + 1;
+                }
+                done.countDown();
+            }(safeValue, executor, done);
+        }
+        done.wait();
+    }
+    CHECK_EQ(*safeValue.readLock(), taskCount * incrementCount);
+}
+
+TEST_CASE("AsyncMutex resumes many waiting coroutines without nesting them")
+{
+    constexpr int taskCount = 100000;
+    safe::Safe<int, safe::AsyncMutex> safeValue(0);
+    Latch done(taskCount);
+    {
+        auto value = safeValue.writeLock();
+        for (int task = 0; task < taskCount; ++task)
+        {
+            [](safe::Safe<int, safe::AsyncMutex> &safeValue, Latch &done) -> Task {
+                {
+                    auto value = co_await safeValue.asyncWriteLock();
+                    ++*value;
+                }
+                done.countDown();
+            }(safeValue, done);
+        }
+    }
+    // Each coroutine hands the mutex over to the next one as it returns: they run one after the other on this thread.
+    done.wait();
+    CHECK_EQ(*safeValue.readLock(), taskCount);
+}
+
+TEST_CASE("AsyncMutex gives the coroutines it hands over to its scheduler")
+{
+    Executor executor(1);
+    safe::Safe<int, safe::AsyncMutex> safeValue(0, [&executor](std::coroutine_handle<> handle) { executor.post(handle); });
+    Latch done(1);
+    std::atomic<bool> resumedOnExecutor{false};
+    {
+        auto value = safeValue.writeLock();
+        [](safe::Safe<int, safe::AsyncMutex> &safeValue, Executor &executor, std::atomic<bool> &resumedOnExecutor,
+           Latch &done) -> Task {
+            {
+                auto value = co_await safeValue.asyncWriteLock();
+                resumedOnExecutor.store(executor.runsOnThisThread());
+            }
+            done.countDown();
+        }(safeValue, executor, resumedOnExecutor, done);
+    }
+    done.wait();
+    CHECK(resumedOnExecutor.load());
+}
+
+TEST_CASE("AsyncMutex does not let coroutines starve blocked threads")
+{
+    safe::Safe<int, safe::AsyncMutex> safeValue(0);
+    Latch done(2);
+    std::atomic<bool> threadLocked{false};
+    std::thread thread;
+    {
+        auto value = safeValue.writeLock();
+        for (int task = 0; task < 2; ++task)
+        {
+            // Without fairness, these coroutines hand the mutex over to each other forever.
+            [](safe::Safe<int, safe::AsyncMutex> &safeValue, std::atomic<bool> &threadLocked, Latch &done) -> Task {
+                while (!threadLocked.load())
+                {
+                    auto value = co_await safeValue.asyncWriteLock();
+                    ++*value;
+                }
+                done.countDown();
+            }(safeValue, threadLocked, done);
+        }
+        thread = std::thread([&safeValue, &threadLocked]() {
+            auto value = safeValue.writeLock();
+            threadLocked.store(true);
+        });
+    }
+    thread.join();
+    done.wait();
+    CHECK(threadLocked.load());
+}
+#endif // __cplusplus >= 202002L
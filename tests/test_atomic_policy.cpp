@@ -0,0 +1,138 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/atomic_policy.h"
+#include "safe/lock_all.h"
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+enum class State
+{
+    Idle,
+    Running,
+    Stopped
+};
+
+// The same code compiles with a mutex and with AtomicPolicy.
+template <typename SafeType> int incrementAndRead(SafeType &safeValue)
+{
+    {
+        safe::WriteAccess<SafeType> value(safeValue);
+        ++*value;
+    }
+    return *safeValue.readLock();
+}
+} // namespace
+
+TEST_CASE("Safe with AtomicPolicy accepts the default_construct_mutex tag")
+{
+    safe::Safe<int, safe::AtomicPolicy> safeValue(42, safe::default_construct_mutex);
+    CHECK_EQ(safeValue.load(), 42);
+    safe::Safe<int, safe::AtomicPolicy> defaultValue(safe::default_construct_mutex);
+    CHECK_EQ(defaultValue.load(), 0);
+}
+
+TEST_CASE("Safe with AtomicPolicy has the same call sites as with a mutex")
+{
+    safe::Safe<int> safeWithMutex(41);
+    safe::Safe<int, safe::AtomicPolicy> safeAtomic(41);
+    CHECK_EQ(incrementAndRead(safeWithMutex), 42);
+    CHECK_EQ(incrementAndRead(safeAtomic), 42);
+}
+
+TEST_CASE("Safe with AtomicPolicy value initializes the value")
+{
+    safe::Safe<int, safe::AtomicPolicy> safeValue;
+    CHECK_EQ(*safeValue.readLock(), 0);
+    safe::Safe<State, safe::AtomicPolicy> safeState;
+    CHECK(*safeState.readLock() == State::Idle);
+}
+
+TEST_CASE("Safe with AtomicPolicy stores the value back when the WriteAccess is destroyed")
+{
+    safe::Safe<State, safe::AtomicPolicy> safeState(State::Idle);
+    {
+        auto state = safeState.writeLock<std::unique_lock>();
+        *state = State::Running;
+        CHECK(*safeState.readLock() == State::Idle);
+        CHECK_FALSE(safeState.mutex().try_lock());
+    }
+    CHECK(*safeState.readLock() == State::Running);
+    CHECK(safeState.mutex().try_lock());
+    safeState.mutex().unlock();
+}
+
+TEST_CASE("Safe with AtomicPolicy does not store the value back if the lock is not owned")
+{
+    safe::Safe<int, safe::AtomicPolicy> safeValue(42);
+    {
+        auto value = safeValue.writeLock<std::unique_lock>(std::defer_lock);
+        *value = 43;
+    }
+    CHECK_EQ(*safeValue.readLock(), 42);
+}
+
+TEST_CASE("Safe with AtomicPolicy writers do not lose updates")
+{
+    safe::Safe<long, safe::AtomicPolicy> safeCounter(0);
+    std::vector<std::thread> writers;
+    for (int writer = 0; writer < 4; ++writer)
+    {
+        writers.emplace_back([&]() {
+            for (int i = 0; i < 10000; ++i)
+            {
+                ++*safeCounter.writeLock<std::unique_lock>();
+            }
+        });
+    }
+    for (auto &writer : writers)
+    {
+        writer.join();
+    }
+    CHECK_EQ(*safeCounter.readLock(), 40000);
+}
+
+TEST_CASE("Safe with AtomicPolicy deferred write accesses see the writes committed before they lock")
+{
+    safe::Safe<int, safe::AtomicPolicy> safeValue(42);
+    {
+        auto value = safeValue.writeLock<std::unique_lock>(std::defer_lock);
+        *safeValue.writeLock() = 43;
+        value.lock.lock();
+        ++*value;
+    }
+    CHECK_EQ(*safeValue.readLock(), 44);
+}
+
+TEST_CASE("Safe with AtomicPolicy does not lose updates through lockAll")
+{
+    safe::Safe<long, safe::AtomicPolicy> safeFirst(0);
+    safe::Safe<long, safe::AtomicPolicy> safeSecond(0);
+    std::thread writer([&]() {
+        for (int i = 0; i < 10000; ++i)
+        {
+            ++*safeFirst.writeLock();
+        }
+    });
+    for (int i = 0; i < 10000; ++i)
+    {
+        auto accesses = safe::lockAll(safeFirst, safeSecond);
+        ++*std::get<0>(accesses);
+        ++*std::get<1>(accesses);
+    }
+    writer.join();
+    CHECK_EQ(*safeFirst.readLock(), 20000);
+    CHECK_EQ(*safeSecond.readLock(), 10000);
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/auto.h"
+
+#include <doctest/doctest.h>
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 201703L
+namespace
+{
+struct Pose
+{
+    double x, y, z;
+    double roll, pitch, yaw;
+};
+struct Frame
+{
+    char pixels[4096];
+};
+
+template <typename SafeType> using MutexOf = std::remove_reference_t<decltype(std::declval<SafeType &>().mutex())>;
+
+static_assert(std::is_same<MutexOf<safe::Auto<long>>, safe::AtomicPolicy>::value,
+              "Small trivially copyable values should be atomic.");
+static_assert(std::is_same<MutexOf<safe::Auto<Pose>>, safe::SeqLock>::value,
+              "Medium trivially copyable values should use a SeqLock.");
+static_assert(std::is_same<MutexOf<safe::Auto<Pose, safe::Workload::WriteHeavy>>, std::mutex>::value,
+              "Write-heavy medium values should use a std::mutex.");
+static_assert(std::is_same<MutexOf<safe::Auto<Frame>>, std::mutex>::value,
+              "Large values should use a std::mutex.");
+static_assert(std::is_same<MutexOf<safe::Auto<std::string, safe::Workload::ReadMostly>>,
+                           safe::DistributedSharedMutex>::value,
+              "Read-mostly non trivially copyable values should use a shared mutex.");
+
+/// The whole API shared by all choices, with the same call sites. key() projects values to something comparable.
+template <typename SafeType, typename ValueType, typename Key>
+void checkSharedApi(SafeType &safeValue, const ValueType &first, const ValueType &second, Key key)
+{
+    *safeValue.writeLock() = first;
+    CHECK_EQ(key(*safeValue.readLock()), key(first));
+
+    {
+        auto access = safeValue.tryWriteLock();
+        REQUIRE(access);
+        *access = second;
+    }
+    {
+        const auto access = safeValue.tryReadLock();
+        REQUIRE(access);
+        CHECK_EQ(key(*access), key(second));
+    }
+    CHECK(safeValue.tryReadLock(safe::Backoff(4)));
+    CHECK(safeValue.tryWriteLock(safe::Backoff(4)));
+
+    safeValue.apply([&](ValueType &value) { value = first; });
+    ValueType applied = second;
+    std::as_const(safeValue).apply([&](const ValueType &value) { applied = value; });
+    CHECK_EQ(key(applied), key(first));
+
+    CHECK_EQ(key(safeValue.load()), key(first));
+    CHECK_EQ(key(safeValue.exchange(second)), key(first));
+    safeValue.store(first);
+    CHECK_EQ(key(safeValue.take()), key(first));
+    CHECK_EQ(key(safeValue.load()), key(ValueType()));
+
+    {
+        const auto access = safeValue.writeLock();
+        std::thread([&]() { CHECK_FALSE(safeValue.tryWriteLock()); }).join();
+    }
+}
+} // namespace
+
+TEST_CASE("safe::Auto objects have the same API whatever the mutex chosen")
+{
+    const auto identity = [](const auto &value) { return value; };
+
+    safe::Auto<long> safeLong;
+    checkSharedApi(safeLong, 42l, 43l, identity);
+
+    const auto yaw = [](const Pose &pose) { return pose.yaw; };
+    safe::Auto<Pose> safePose;
+    checkSharedApi(safePose, Pose{1., 2., 3., 4., 5., 6.}, Pose{6., 5., 4., 3., 2., 1.}, yaw);
+
+    safe::Auto<Pose, safe::Workload::WriteHeavy> writeHeavyPose;
+    checkSharedApi(writeHeavyPose, Pose{1., 2., 3., 4., 5., 6.}, Pose{6., 5., 4., 3., 2., 1.}, yaw);
+
+    safe::Auto<std::string, safe::Workload::ReadMostly> safeString;
+    checkSharedApi(safeString, std::string("hello"), std::string("world"), identity);
+    CHECK_EQ(safeString.readLock()->size(), 0u);
+}
+#endif // __cplusplus >= 201703L
@@ -0,0 +1,50 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/cache_line.h"
+#include "safe/safe.h"
+
+#include <doctest/doctest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+TEST_CASE("PaddedMutex keeps the mutex and the value on different cache lines")
+{
+    using PaddedSafe = safe::Safe<int, safe::PaddedMutex<std::mutex>>;
+    static_assert(alignof(PaddedSafe) == safe::cacheLineSize, "PaddedMutex is not aligned!");
+
+    PaddedSafe safeValue(42);
+    const auto mutexAddress = reinterpret_cast<std::uintptr_t>(&safeValue.mutex());
+    const auto valueAddress = reinterpret_cast<std::uintptr_t>(&safeValue.unsafe());
+    CHECK_NE(mutexAddress / safe::cacheLineSize, valueAddress / safe::cacheLineSize);
+    CHECK_EQ(*safeValue.readLock<std::unique_lock>(), 42);
+}
+
+TEST_CASE("Aligned Safe objects never share a cache line")
+{
+    using AlignedSafe = safe::Aligned<safe::Safe<int>>;
+    static_assert(alignof(AlignedSafe) == safe::cacheLineSize, "Aligned is not aligned!");
+    static_assert(sizeof(AlignedSafe) % safe::cacheLineSize == 0, "Aligned is not padded!");
+
+    AlignedSafe safeValues[2];
+    CHECK_EQ(reinterpret_cast<std::uintptr_t>(&safeValues[0]) % safe::cacheLineSize, 0u);
+    CHECK_EQ(reinterpret_cast<std::uintptr_t>(&safeValues[1]) % safe::cacheLineSize, 0u);
+}
+
+TEST_CASE("Aligned Safe objects are used like Safe objects")
+{
+    std::mutex mutex;
+    safe::Aligned<safe::Safe<int, std::mutex &>> safeValue(42, mutex);
+    CHECK_EQ(&safeValue.mutex(), &mutex);
+    {
+        safe::WriteAccess<safe::Aligned<safe::Safe<int, std::mutex &>>> value(safeValue);
+        *value = 24;
+    }
+    CHECK_EQ(*safeValue.readLock<std::unique_lock>(), 24);
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/combining_mutex.h"
+#include "safe/safe.h"
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Safe::apply locks plain mutexes")
+{
+    safe::Safe<int> safeValue(42);
+    safeValue.apply([](int &value) { ++value; });
+
+    const auto &constSafeValue = safeValue;
+    int read = 0;
+    constSafeValue.apply([&](const int &value) { read = value; });
+    CHECK_EQ(read, 43);
+    CHECK(safeValue.mutex().try_lock());
+    safeValue.mutex().unlock();
+}
+
+TEST_CASE("Safe::apply with a CombiningMutex")
+{
+    safe::Safe<std::deque<int>, safe::CombiningMutex> safeQueue;
+    safeQueue.apply([](std::deque<int> &queue) { queue.push_back(1); });
+    CHECK_EQ(safeQueue.readLock()->size(), 1u);
+    CHECK(safeQueue.mutex().try_lock());
+    safeQueue.mutex().unlock();
+}
+
+TEST_CASE("The CombiningMutex holder executes pending functions")
+{
+    safe::Safe<std::vector<int>, safe::CombiningMutex> safeValues;
+    std::atomic<bool> published{false};
+    std::thread::id holderId;
+    std::thread::id executorId;
+
+    std::thread holder([&]() {
+        holderId = std::this_thread::get_id();
+        safeValues.apply([&](std::vector<int> &values) {
+            // Hold the mutex until the other thread has published its function.
+            while (!published.load())
+            {
+                std::this_thread::yield();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            values.push_back(1);
+        });
+    });
+    while (safeValues.mutex().try_lock())
+    {
+        safeValues.mutex().unlock();
+        std::this_thread::yield();
+    }
+    published.store(true);
+    safeValues.apply([&](std::vector<int> &values) {
+        executorId = std::this_thread::get_id();
+        values.push_back(2);
+    });
+    holder.join();
+
+    const std::vector<int> expected = {1, 2};
+    CHECK_EQ(*safeValues.readLock(), expected);
+    CHECK_EQ(executorId, holderId);
+}
+
+TEST_CASE("CombiningMutex rethrows exceptions on the calling thread")
+{
+    safe::Safe<int, safe::CombiningMutex> safeValue(0);
+    bool thrown = false;
+    std::thread waiter;
+    {
+        safe::WriteAccess<safe::Safe<int, safe::CombiningMutex>> value(safeValue);
+        waiter = std::thread([&]() {
+            try
+            {
+                safeValue.apply([](int &) { throw std::runtime_error("apply"); });
+            }
+            catch (const std::runtime_error &)
+            {
+                thrown = true;
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    waiter.join();
+    CHECK(thrown);
+    CHECK_THROWS_AS(safeValue.apply([](int &) { throw std::runtime_error("apply"); }), std::runtime_error);
+    CHECK(safeValue.mutex().try_lock());
+    safeValue.mutex().unlock();
+}
+
+TEST_CASE("Combined functions are all executed")
+{
+    safe::Safe<long, safe::CombiningMutex> safeCounter(0);
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < 4; ++thread)
+    {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 10000; ++i)
+            {
+                safeCounter.apply([](long &counter) { ++counter; });
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    CHECK_EQ(*safeCounter.readLock(), 40000);
+}
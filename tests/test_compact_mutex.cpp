@@ -0,0 +1,97 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/compact_mutex.h"
+#include "safe/safe.h"
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+template <typename MutexType> void checkExclusion()
+{
+    MutexType mutex;
+    CHECK(mutex.try_lock());
+    std::thread([&]() { CHECK_FALSE(mutex.try_lock()); }).join();
+    mutex.unlock();
+    CHECK(mutex.try_lock());
+    mutex.unlock();
+}
+
+template <typename MutexType> void checkNoLostUpdates()
+{
+    constexpr int threadCount = 4;
+    constexpr int incrementCount = 10000;
+    safe::Safe<int, MutexType> safeValue(0);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < incrementCount; ++j)
+            {
+                safe::WriteAccess<safe::Safe<int, MutexType>> value(safeValue);
+                ++*value;
+                if (j % 1000 == 0)
+                {
+                    // Make the other threads sleep.
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    CHECK_EQ(safeValue.load(), threadCount * incrementCount);
+}
+} // namespace
+
+TEST_CASE("Compact mutexes are compact")
+{
+    static_assert(sizeof(safe::FutexMutex) == 4, "FutexMutex should take 4 bytes.");
+    static_assert(sizeof(safe::ParkingMutex) == 1, "ParkingMutex should take 1 byte.");
+    static_assert(sizeof(safe::Safe<std::uint32_t, safe::FutexMutex>) == 8,
+                  "Safe<std::uint32_t, FutexMutex> should take 8 bytes.");
+    static_assert(sizeof(safe::Safe<std::uint16_t, safe::ParkingMutex>) == 4,
+                  "Safe<std::uint16_t, ParkingMutex> should take 4 bytes.");
+    CHECK_LT(sizeof(safe::Safe<int, safe::FutexMutex>), sizeof(safe::Safe<int>));
+}
+
+TEST_CASE("FutexMutex excludes other threads")
+{
+    checkExclusion<safe::FutexMutex>();
+    checkNoLostUpdates<safe::FutexMutex>();
+}
+
+TEST_CASE("ParkingMutex excludes other threads")
+{
+    checkExclusion<safe::ParkingMutex>();
+    checkNoLostUpdates<safe::ParkingMutex>();
+}
+
+TEST_CASE("ParkingMutex wakes up sleeping threads")
+{
+    safe::Safe<int, safe::ParkingMutex> safeValue(0);
+    std::thread waiter;
+    {
+        safe::WriteAccess<safe::Safe<int, safe::ParkingMutex>> value(safeValue);
+        waiter = std::thread([&]() { ++*safe::WriteAccess<safe::Safe<int, safe::ParkingMutex>>(safeValue); });
+        // Long enough for the waiter to stop spinning and sleep.
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ++*value;
+    }
+    waiter.join();
+    CHECK_EQ(safeValue.load(), 2);
+}
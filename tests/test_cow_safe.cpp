@@ -0,0 +1,99 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/cow_safe.h"
+#include "safe/lock_all.h"
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+
+TEST_CASE("CowSafe publishes the copy when the WriteAccess is destroyed")
+{
+    safe::CowSafe<std::map<int, std::string>> safeMap;
+    const auto before = safeMap.readLock();
+    {
+        safe::WriteAccess<safe::CowSafe<std::map<int, std::string>>> map(safeMap);
+        (*map)[1] = "one";
+        CHECK(safeMap.readLock()->empty());
+    }
+    CHECK_EQ(safeMap.readLock()->at(1), "one");
+    // Snapshots taken before the write stay valid and unchanged.
+    CHECK(before->empty());
+}
+
+TEST_CASE("CowSafe readers do not wait for writers")
+{
+    safe::CowSafe<int> safeValue(42);
+    auto value = safeValue.writeLock<std::unique_lock>();
+    *value = 43;
+
+    std::atomic<int> read{0};
+    std::thread reader([&]() { read.store(*safeValue.readLock()); });
+    reader.join();
+
+    CHECK_EQ(read.load(), 42);
+}
+
+TEST_CASE("CowSafe writers exclude each other")
+{
+    safe::CowSafe<int> safeValue(0);
+    std::thread writers[2];
+    for (auto &writer : writers)
+    {
+        writer = std::thread([&]() {
+            for (int i = 0; i < 1000; ++i)
+            {
+                ++*safeValue.writeLock<std::unique_lock>();
+            }
+        });
+    }
+    for (auto &writer : writers)
+    {
+        writer.join();
+    }
+    CHECK_EQ(*safeValue.readLock(), 2000);
+}
+
+TEST_CASE("CowSafe does not publish if the lock is not owned")
+{
+    safe::CowSafe<int> safeValue(42);
+    {
+        auto value = safeValue.writeLock<std::unique_lock>(std::defer_lock);
+        CHECK_FALSE(value.lock.owns_lock());
+    }
+    CHECK_EQ(*safeValue.readLock(), 42);
+}
+
+TEST_CASE("CowSafe deferred write accesses copy the value once they lock")
+{
+    safe::CowSafe<int> safeValue(42);
+    {
+        auto value = safeValue.writeLock<std::unique_lock>(std::defer_lock);
+        *safeValue.writeLock() = 43;
+        value.lock.lock();
+        ++*value;
+    }
+    CHECK_EQ(*safeValue.readLock(), 44);
+}
+
+TEST_CASE("CowSafe write accesses work through lockAll")
+{
+    safe::CowSafe<std::string> safeFrom("hello");
+    safe::CowSafe<std::string> safeTo;
+    {
+        auto accesses = safe::lockAll(safeFrom, safeTo);
+        std::get<1>(accesses)->swap(*std::get<0>(accesses));
+    }
+    CHECK_EQ(*safeFrom.readLock(), "");
+    CHECK_EQ(*safeTo.readLock(), "hello");
+}
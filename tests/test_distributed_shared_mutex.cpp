@@ -0,0 +1,104 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/distributed_shared_mutex.h"
+#include "safe/safe.h"
+
+#include <doctest/doctest.h>
+
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+TEST_CASE("DistributedSharedMutex readers exclude writers")
+{
+    safe::DistributedSharedMutex mutex;
+    CHECK(mutex.try_lock_shared());
+    std::thread([&]() {
+        CHECK(mutex.try_lock_shared());
+        CHECK_FALSE(mutex.try_lock());
+        mutex.unlock_shared();
+    }).join();
+    mutex.unlock_shared();
+    CHECK(mutex.try_lock());
+    mutex.unlock();
+}
+
+TEST_CASE("DistributedSharedMutex writers exclude readers and writers")
+{
+    safe::DistributedSharedMutex mutex;
+    mutex.lock();
+    std::thread([&]() {
+        CHECK_FALSE(mutex.try_lock_shared());
+        CHECK_FALSE(mutex.try_lock());
+    }).join();
+    mutex.unlock();
+    CHECK(mutex.try_lock_shared());
+    mutex.unlock_shared();
+}
+
+TEST_CASE("DistributedSharedMutex writers wait for readers")
+{
+    safe::DistributedSharedMutex mutex;
+    int value = 0;
+    mutex.lock_shared();
+    std::thread writer([&]() {
+        std::lock_guard<safe::DistributedSharedMutex> lock(mutex);
+        value = 1;
+    });
+    // The writer cannot modify the value while it is read.
+    std::this_thread::yield();
+    CHECK_EQ(value, 0);
+    mutex.unlock_shared();
+    writer.join();
+    mutex.lock_shared();
+    CHECK_EQ(value, 1);
+    mutex.unlock_shared();
+}
+
+#if __cplusplus >= 201402L
+TEST_CASE("Safe with DistributedSharedMutex gives shared read accesses by default")
+{
+    using SafeType = safe::Safe<int, safe::DistributedSharedMutex>;
+    static_assert(std::is_same<safe::DefaultReadOnlyLockType<safe::DistributedSharedMutex>,
+                               std::shared_lock<safe::DistributedSharedMutex>>::value,
+                  "Read accesses should use std::shared_lock by default.");
+    SafeType safeValue(42);
+    const safe::ReadAccess<SafeType> value(safeValue);
+    std::thread([&]() { CHECK(safeValue.readLock<std::shared_lock>(std::try_to_lock).lock.owns_lock()); }).join();
+    CHECK_EQ(*value, 42);
+}
+#endif // __cplusplus >= 201402L
+
+TEST_CASE("Safe with DistributedSharedMutex does not lose updates")
+{
+    constexpr int threadCount = 4;
+    constexpr int incrementCount = 1000;
+    safe::Safe<int, safe::DistributedSharedMutex> safeValue(0);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < incrementCount; ++j)
+            {
+                {
+                    safe::WriteAccess<safe::Safe<int, safe::DistributedSharedMutex>> value(safeValue);
+                    ++*value;
+                }
+                safe::ReadAccess<safe::Safe<int, safe::DistributedSharedMutex>> value(safeValue);
+                CHECK_GT(*value, 0);
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    CHECK_EQ(*safeValue.readLock(), threadCount * incrementCount);
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/atomic_policy.h"
+#include "safe/safe.h"
+#include "safe/seqlock.h"
+
+#include <doctest/doctest.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+/// Mutex that tells whether it is locked.
+struct FlagMutex
+{
+    void lock()
+    {
+        mutex.lock();
+        locked = true;
+    }
+    bool try_lock()
+    {
+        if (mutex.try_lock())
+        {
+            locked = true;
+            return true;
+        }
+        return false;
+    }
+    void unlock()
+    {
+        locked = false;
+        mutex.unlock();
+    }
+
+    std::mutex mutex;
+    bool locked = false;
+};
+
+/// Records whether the mutex was locked when it was destroyed.
+struct Probe
+{
+    Probe() = default;
+    Probe(const FlagMutex &mutex, bool &destroyedLocked) : mutex(&mutex), destroyedLocked(&destroyedLocked)
+    {
+    }
+    ~Probe()
+    {
+        if (mutex != nullptr)
+        {
+            *destroyedLocked = mutex->locked;
+        }
+    }
+
+    const FlagMutex *mutex = nullptr;
+    bool *destroyedLocked = nullptr;
+};
+} // namespace
+
+TEST_CASE("load copies the value out")
+{
+    const safe::Safe<std::string> safeString("hello");
+    const std::string string = safeString.load();
+    CHECK_EQ(string, "hello");
+    CHECK_NE(&string, &safeString.unsafe());
+}
+
+TEST_CASE("exchange, take and store replace the value")
+{
+    safe::Safe<std::vector<int>> safeVector(3, 42);
+    CHECK_EQ(safeVector.exchange(std::vector<int>{1, 2}), std::vector<int>(3, 42));
+    CHECK_EQ(safeVector.take(), std::vector<int>{1, 2});
+    CHECK(safeVector.unsafe().empty());
+    safeVector.store(std::vector<int>{3});
+    CHECK_EQ(safeVector.load(), std::vector<int>{3});
+}
+
+TEST_CASE("The old value is destroyed after the mutex is unlocked")
+{
+    safe::Safe<Probe, FlagMutex> safeProbe;
+    bool destroyedLocked = false;
+    safeProbe.store(Probe(safeProbe.mutex(), destroyedLocked));
+    destroyedLocked = true;
+    safeProbe.store(Probe());
+    CHECK_FALSE(destroyedLocked);
+
+    safeProbe.store(Probe(safeProbe.mutex(), destroyedLocked));
+    destroyedLocked = true;
+    safeProbe.take();
+    CHECK_FALSE(destroyedLocked);
+}
+
+TEST_CASE("Safe with SeqLock and AtomicPolicy have exchange, take and store")
+{
+    safe::Safe<long, safe::SeqLock> safeSeqLock(1);
+    CHECK_EQ(safeSeqLock.exchange(2), 1);
+    CHECK_EQ(safeSeqLock.take(), 2);
+    safeSeqLock.store(3);
+    CHECK_EQ(safeSeqLock.load(), 3);
+
+    safe::Safe<long, safe::AtomicPolicy> safeAtomic(1);
+    CHECK_EQ(safeAtomic.exchange(2), 1);
+    CHECK_EQ(safeAtomic.take(), 2);
+    safeAtomic.store(3);
+    CHECK_EQ(safeAtomic.load(), 3);
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/for_each_locked.h"
+#include "safe/safe.h"
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("forEachLocked visits busy Safe objects after the free ones")
+{
+    std::vector<safe::Safe<int>> safeValues(5);
+    int index = 0;
+    for (auto &safeValue : safeValues)
+    {
+        safeValue.unsafe() = index++;
+    }
+
+    std::atomic<bool> locked{false};
+    std::atomic<bool> release{false};
+    std::thread owner([&]() {
+        std::lock_guard<std::mutex> lock(safeValues[1].mutex());
+        locked.store(true);
+        while (!release.load())
+        {
+            std::this_thread::yield();
+        }
+    });
+    while (!locked.load())
+    {
+        std::this_thread::yield();
+    }
+
+    std::vector<int> visited;
+    safe::forEachLocked(safeValues, [&](int &value) {
+        visited.push_back(value);
+        value += 10;
+        // Let the owner go once all free values are visited.
+        if (visited.size() == 4)
+        {
+            release.store(true);
+        }
+    });
+    owner.join();
+
+    CHECK_EQ(visited, std::vector<int>{0, 2, 3, 4, 1});
+    for (int value = 0; value < 5; ++value)
+    {
+        CHECK_EQ(safeValues[value].unsafe(), value + 10);
+    }
+}
+
+TEST_CASE("forEachLocked read-locks the Safe objects of a const range")
+{
+    const std::vector<safe::Safe<int>> safeValues(3);
+    int sum = 1;
+    safe::forEachLocked(safeValues, [&](const int &value) { sum += value; });
+    CHECK_EQ(sum, 1);
+}
+
+TEST_CASE("forEachLocked splits the range between threads")
+{
+    std::vector<safe::Safe<int>> safeValues(1000);
+    std::atomic<int> calls{0};
+    safe::forEachLocked(
+        safeValues,
+        [&](int &value) {
+            ++value;
+            ++calls;
+        },
+        4);
+    CHECK_EQ(calls.load(), 1000);
+    for (const auto &safeValue : safeValues)
+    {
+        CHECK_EQ(safeValue.unsafe(), 1);
+    }
+
+    CHECK_THROWS_AS(safe::forEachLocked(
+                        safeValues, [](int &value) { throw std::runtime_error(std::to_string(value)); }, 4),
+                    std::runtime_error);
+}
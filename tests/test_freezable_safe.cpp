@@ -0,0 +1,89 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/freezable_safe.h"
+
+#include <doctest/doctest.h>
+
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+TEST_CASE("FreezableSafe read accesses lock the mutex until it is frozen")
+{
+    safe::FreezableSafe<int> safeValue(42);
+    REQUIRE_FALSE(safeValue.frozen());
+    {
+        auto value = safeValue.readLock();
+        CHECK(value.lock.owns_lock());
+        CHECK_EQ(*value, 42);
+        std::thread([&]() { CHECK_FALSE(safeValue.mutex().try_lock()); }).join();
+    }
+
+    safeValue.freeze();
+    REQUIRE(safeValue.frozen());
+    auto value = safeValue.readLock();
+    CHECK_FALSE(value.lock.owns_lock());
+    CHECK_EQ(*value, 42);
+    std::thread([&]() {
+        CHECK(safeValue.mutex().try_lock());
+        safeValue.mutex().unlock();
+    }).join();
+}
+
+TEST_CASE("FreezableSafe write accesses throw once it is frozen")
+{
+    safe::FreezableSafe<int> safeValue(42);
+    *safeValue.writeLock() = 43;
+    safeValue.freeze();
+
+    CHECK_THROWS_AS(safeValue.writeLock(), std::logic_error);
+    // The mutex was unlocked when the write access threw.
+    CHECK(safeValue.mutex().try_lock());
+    safeValue.mutex().unlock();
+    CHECK_EQ(safeValue.unsafe(), 43);
+}
+
+TEST_CASE("FreezableSafe write accesses must own the mutex")
+{
+    safe::FreezableSafe<int> safeValue(42);
+    // Otherwise, they could lock it after freeze().
+    CHECK_THROWS_AS(safeValue.writeLock<std::unique_lock>(std::defer_lock), std::logic_error);
+    safeValue.mutex().lock();
+    std::thread([&safeValue]() {
+        CHECK_THROWS_AS(safeValue.writeLock<std::unique_lock>(std::try_to_lock), std::logic_error);
+    }).join();
+    safeValue.mutex().unlock();
+
+    CHECK_EQ(*safeValue.writeLock<std::unique_lock>(std::try_to_lock), 42);
+}
+
+TEST_CASE("FreezableSafe readers that do not lock see the values written before freeze()")
+{
+    safe::FreezableSafe<std::map<int, std::string>> safeMap;
+    std::thread reader([&]() {
+        while (!safeMap.frozen())
+        {
+            std::this_thread::yield();
+        }
+        auto map = safeMap.readLock();
+        REQUIRE_FALSE(map.lock.owns_lock());
+        CHECK_EQ(map->size(), 100u);
+        CHECK_EQ(map->at(99), "99");
+    });
+    {
+        safe::WriteAccess<safe::FreezableSafe<std::map<int, std::string>>> map(safeMap);
+        for (int key = 0; key < 100; ++key)
+        {
+            map->emplace(key, std::to_string(key));
+        }
+    }
+    safeMap.freeze();
+    reader.join();
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/instrumented_mutex.h"
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace
+{
+std::uint64_t count(const safe::DurationHistogram &histogram)
+{
+    std::uint64_t total = 0;
+    for (const auto bucket : histogram.buckets)
+    {
+        total += bucket;
+    }
+    return total;
+}
+} // namespace
+
+TEST_CASE("InstrumentedMutex counts acquisitions")
+{
+    safe::Safe<int, safe::InstrumentedMutex<>> safeValue(0, "counter");
+    CHECK_EQ(safeValue.mutex().name(), "counter");
+
+    for (int i = 0; i < 10; ++i)
+    {
+        ++*safeValue.writeLock();
+    }
+    CHECK(safeValue.mutex().try_lock());
+    safeValue.mutex().unlock();
+
+    const auto stats = safeValue.mutex().stats();
+    CHECK_EQ(stats.acquisitions, 11u);
+    CHECK_EQ(stats.contendedAcquisitions, 0u);
+    CHECK_EQ(count(stats.hold), 11u);
+    CHECK_EQ(count(stats.wait), 0u);
+}
+
+TEST_CASE("InstrumentedMutex records contended acquisitions")
+{
+    safe::Safe<int, safe::InstrumentedMutex<>> safeValue(0);
+    std::thread waiter;
+    {
+        safe::WriteAccess<safe::Safe<int, safe::InstrumentedMutex<>>> value(safeValue);
+        waiter = std::thread([&]() { ++*safeValue.writeLock(); });
+        // Wait until the other thread has tried to lock the mutex.
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    waiter.join();
+
+    const auto stats = safeValue.mutex().stats();
+    CHECK_EQ(stats.acquisitions, 2u);
+    CHECK_EQ(stats.contendedAcquisitions, 1u);
+    CHECK_EQ(count(stats.wait), 1u);
+    CHECK_GE(stats.wait.totalNanoseconds, 10000000u);
+    CHECK_GE(stats.hold.totalNanoseconds, 10000000u);
+}
+
+TEST_CASE("InstrumentedMutex defaults to std::lock_guard")
+{
+    using MutexType = safe::InstrumentedMutex<>;
+    CHECK(std::is_same<safe::DefaultReadOnlyLockType<MutexType>, std::lock_guard<MutexType>>::value);
+    CHECK(std::is_same<safe::DefaultReadWriteLockType<MutexType>, std::lock_guard<MutexType>>::value);
+}
+
+TEST_CASE("ContentionRegistry dumps the living mutexes")
+{
+    std::ostringstream text;
+    std::ostringstream json;
+    {
+        safe::Safe<int, safe::InstrumentedMutex<>> safeValue(0, std::string("registered \"value\""));
+        *safeValue.writeLock() = 1;
+        safe::ContentionRegistry::instance().dumpText(text);
+        safe::ContentionRegistry::instance().dumpJson(json);
+    }
+    CHECK_NE(text.str().find("registered \"value\": 1 acquisitions, 0 contended"), std::string::npos);
+    CHECK_NE(json.str().find("{\"name\":\"registered \\\"value\\\"\",\"acquisitions\":1,"), std::string::npos);
+    CHECK_EQ(json.str().front(), '[');
+    CHECK_EQ(json.str().back(), ']');
+
+    std::ostringstream after;
+    safe::ContentionRegistry::instance().dumpText(after);
+    CHECK_EQ(after.str().find("registered"), std::string::npos);
+}
+
+TEST_CASE("ContentionRegistry escapes control characters in JSON names")
+{
+    std::ostringstream json;
+    {
+        safe::Safe<int, safe::InstrumentedMutex<>> safeValue(0, std::string("line\nbreak\ttab\\\x01\x1f"));
+        safe::ContentionRegistry::instance().dumpJson(json);
+    }
+    CHECK_NE(json.str().find("{\"name\":\"line\\nbreak\\ttab\\\\\\u0001\\u001f\","), std::string::npos);
+    CHECK_EQ(json.str().find('\n'), std::string::npos);
+    CHECK_EQ(json.str().find('\x01'), std::string::npos);
+}
@@ -0,0 +1,109 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/left_right_safe.h"
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("LeftRightSafe applies modifications to both instances")
+{
+    safe::LeftRightSafe<std::vector<int>> safeVector(3, 0);
+    safeVector.apply([](std::vector<int> &vector) { vector.push_back(42); });
+    CHECK_EQ(safeVector.readLock()->size(), 4u);
+    safeVector.apply([](std::vector<int> &vector) { vector.pop_back(); });
+    CHECK_EQ(safeVector.readLock()->size(), 3u);
+    safeVector.apply([](std::vector<int> &vector) { vector.push_back(24); });
+    safe::ReadAccess<safe::LeftRightSafe<std::vector<int>>> vector(safeVector);
+    CHECK_EQ(vector->back(), 24);
+}
+
+TEST_CASE("LeftRightSafe keeps both instances identical when the function throws")
+{
+    safe::LeftRightSafe<std::vector<int>> safeVector;
+    for (int failingCall = 1; failingCall <= 2; ++failingCall)
+    {
+        int call = 0;
+        CHECK_THROWS_AS(safeVector.apply([&](std::vector<int> &vector) {
+            vector.push_back(failingCall);
+            if (++call == failingCall)
+            {
+                throw std::runtime_error("failed");
+            }
+        }),
+                        std::runtime_error);
+    }
+    // The first modification was undone, the second one was completed.
+    CHECK_EQ(*safeVector.readLock(), std::vector<int>{2});
+    // Readers switch over to the other instance.
+    safeVector.apply([](std::vector<int> &vector) { vector.push_back(3); });
+    CHECK_EQ(*safeVector.readLock(), std::vector<int>{2, 3});
+    safeVector.apply([](std::vector<int> &vector) { vector.push_back(4); });
+    CHECK_EQ(*safeVector.readLock(), std::vector<int>{2, 3, 4});
+}
+
+TEST_CASE("LeftRightSafe writers wait for readers of the instance they modify")
+{
+    safe::LeftRightSafe<int> safeValue(0);
+    std::atomic<bool> written{false};
+    std::thread writer;
+    {
+        const auto value = safeValue.readLock();
+        writer = std::thread([&]() {
+            safeValue.apply([](int &v) { ++v; });
+            written.store(true);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        // The writer modified the other instance but cannot modify this one while it is read.
+        CHECK_EQ(*value, 0);
+        CHECK_FALSE(written.load());
+    }
+    writer.join();
+    CHECK(written.load());
+    CHECK_EQ(*safeValue.readLock(), 1);
+}
+
+TEST_CASE("LeftRightSafe readers always see a consistent value")
+{
+    struct Pair
+    {
+        long first;
+        long second;
+    };
+    safe::LeftRightSafe<Pair> safePair(Pair{0, 0});
+    std::atomic<bool> stop{false};
+    std::atomic<bool> torn{false};
+
+    std::thread reader([&]() {
+        while (!stop.load())
+        {
+            const auto pair = safePair.readLock();
+            if (pair->first != pair->second)
+            {
+                torn.store(true);
+            }
+        }
+    });
+    for (int i = 0; i < 1000; ++i)
+    {
+        safePair.apply([](Pair &pair) {
+            ++pair.first;
+            std::this_thread::yield();
+            ++pair.second;
+        });
+    }
+    stop.store(true);
+    reader.join();
+
+    CHECK_FALSE(torn.load());
+    CHECK_EQ(safePair.readLock()->first, 1000);
+}
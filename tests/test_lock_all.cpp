@@ -0,0 +1,131 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/lock_all.h"
+
+#include <doctest/doctest.h>
+
+#include <mutex>
+#if __cplusplus >= 201703L
+#include <shared_mutex>
+#endif // __cplusplus >= 201703L
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+TEST_CASE("lockAll write-locks non-const Safe objects and read-locks const Safe objects")
+{
+    safe::Safe<int> safeInt(42);
+    safe::Safe<double> safeDouble(3.14);
+    const safe::Safe<double> &constSafeDouble = safeDouble;
+
+    auto accesses = safe::lockAll(safeInt, constSafeDouble);
+
+    static_assert(std::is_same<decltype(accesses), std::tuple<safe::Safe<int>::WriteAccess<std::unique_lock>,
+                                                              safe::Safe<double>::ReadAccess<std::unique_lock>>>::value,
+                  "lockAll returned the wrong Access types!");
+    CHECK(std::get<0>(accesses).lock.owns_lock());
+    CHECK(std::get<1>(accesses).lock.owns_lock());
+    CHECK_EQ(&*std::get<0>(accesses), &safeInt.unsafe());
+    CHECK_EQ(*std::get<1>(accesses), 3.14);
+}
+
+TEST_CASE("lockAll releases the mutexes when the Access objects are destroyed")
+{
+    safe::Safe<int> first;
+    safe::Safe<int> second;
+    {
+        auto accesses = safe::lockAll(first, second);
+        CHECK_FALSE(first.mutex().try_lock());
+        CHECK_FALSE(second.mutex().try_lock());
+    }
+    CHECK(first.mutex().try_lock());
+    CHECK(second.mutex().try_lock());
+    first.mutex().unlock();
+    second.mutex().unlock();
+}
+
+TEST_CASE("lockAll waits for a busy mutex without holding the others")
+{
+    safe::Safe<int> first;
+    safe::Safe<int> second;
+
+    auto busy = second.writeLock<std::unique_lock>();
+    std::thread locker([&]() {
+        auto accesses = safe::lockAll(first, second);
+        *std::get<0>(accesses) = *std::get<1>(accesses);
+    });
+    // Back-off releases the first mutex while the second one is busy, so it can still be locked from here.
+    for (int i = 0; i < 100; ++i)
+    {
+        first.writeLock<std::unique_lock>();
+        std::this_thread::yield();
+    }
+    *busy = 42;
+    busy.lock.unlock();
+    locker.join();
+
+    CHECK_EQ(first.unsafe(), 42);
+}
+
+TEST_CASE("lockAll does not deadlock when Safe objects are locked in opposite orders")
+{
+    safe::Safe<int> first(0);
+    safe::Safe<int> second(0);
+    static constexpr int iterations = 10000;
+
+    std::thread forward([&]() {
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto accesses = safe::lockAll(first, second);
+            ++*std::get<0>(accesses);
+            --*std::get<1>(accesses);
+        }
+    });
+    std::thread backward([&]() {
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto accesses = safe::lockAll(second, first);
+            ++*std::get<0>(accesses);
+            --*std::get<1>(accesses);
+        }
+    });
+    forward.join();
+    backward.join();
+
+    CHECK_EQ(first.unsafe(), 0);
+    CHECK_EQ(second.unsafe(), 0);
+}
+
+TEST_CASE("lockAll rejects Safe objects that share a mutex")
+{
+    std::mutex mutex;
+    int first = 1;
+    int second = 2;
+    safe::Safe<int &, std::mutex &> safeFirst(first, mutex);
+    safe::Safe<int &, std::mutex &> safeSecond(second, mutex);
+    CHECK_THROWS_AS(safe::lockAll(safeFirst, safeSecond), std::logic_error);
+    // Nothing was left locked.
+    CHECK(mutex.try_lock());
+    mutex.unlock();
+}
+
+#if __cplusplus >= 201703L
+TEST_CASE("lockAll can use shared locks for const Safe objects")
+{
+    safe::Safe<int, std::shared_mutex> source(42);
+    safe::Safe<int, std::shared_mutex> destination;
+
+    auto [from, to] = safe::lockAll<std::shared_lock>(std::as_const(source), destination);
+    *to = *from;
+
+    CHECK(source.mutex().try_lock_shared());
+    source.mutex().unlock_shared();
+    CHECK_EQ(destination.unsafe(), 42);
+}
+#endif // __cplusplus >= 201703L
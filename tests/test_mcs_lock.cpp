@@ -0,0 +1,132 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/lock_all.h"
+#include "safe/mcs_lock.h"
+#include "safe/safe.h"
+
+#include <doctest/doctest.h>
+
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+TEST_CASE("McsLock excludes other threads until unlocked")
+{
+    safe::McsLock mutex;
+    safe::McsLock::Node node;
+    CHECK(mutex.try_lock(node));
+    std::thread([&]() {
+        safe::McsLock::Node otherNode;
+        CHECK_FALSE(mutex.try_lock(otherNode));
+    }).join();
+    mutex.unlock(node);
+    CHECK(mutex.try_lock(node));
+    mutex.unlock(node);
+}
+
+TEST_CASE("Safe with McsLock uses McsGuard by default")
+{
+    using SafeType = safe::Safe<int, safe::McsLock>;
+    static_assert(std::is_same<safe::DefaultReadWriteLockType<safe::McsLock>, safe::McsGuard<safe::McsLock>>::value,
+                  "McsGuard should be the default lock type.");
+    SafeType safeValue(42);
+    {
+        safe::WriteAccess<SafeType> value(safeValue);
+        ++*value;
+        safe::McsLock::Node node;
+        CHECK_FALSE(safeValue.mutex().try_lock(node));
+    }
+    safe::McsLock::Node node;
+    CHECK(safeValue.mutex().try_lock(node));
+    safeValue.mutex().unlock(node);
+    CHECK_EQ(*safe::ReadAccess<SafeType>(safeValue), 43);
+}
+
+TEST_CASE("Safe with McsLock does not lose updates")
+{
+    constexpr int threadCount = 4;
+    constexpr int incrementCount = 1000;
+    safe::Safe<int, safe::McsLock> safeValue(0);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < incrementCount; ++j)
+            {
+                safeValue.apply([](int &value) { ++value; });
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    CHECK_EQ(*safe::ReadAccess<safe::Safe<int, safe::McsLock>>(safeValue), threadCount * incrementCount);
+}
+
+TEST_CASE("McsLock can be locked without a node of the caller's")
+{
+    safe::McsLock mutex;
+    {
+        std::unique_lock<safe::McsLock> lock(mutex);
+        std::thread([&]() { CHECK_FALSE(std::unique_lock<safe::McsLock>(mutex, std::try_to_lock).owns_lock()); })
+            .join();
+    }
+    CHECK(std::unique_lock<safe::McsLock>(mutex, std::try_to_lock).owns_lock());
+}
+
+TEST_CASE("McsLock throws if a thread holds too many McsLocks without a node of its own")
+{
+    safe::McsLock mutexes[safe::McsLock::maxThreadNodes + 1];
+    for (std::size_t index = 0; index < safe::McsLock::maxThreadNodes; ++index)
+    {
+        mutexes[index].lock();
+    }
+    CHECK_THROWS_AS(mutexes[safe::McsLock::maxThreadNodes].lock(), std::system_error);
+    CHECK_THROWS_AS(mutexes[safe::McsLock::maxThreadNodes].try_lock(), std::system_error);
+    for (std::size_t index = 0; index < safe::McsLock::maxThreadNodes; ++index)
+    {
+        mutexes[index].unlock();
+    }
+    // The nodes were given back.
+    mutexes[safe::McsLock::maxThreadNodes].lock();
+    mutexes[safe::McsLock::maxThreadNodes].unlock();
+}
+
+TEST_CASE("Safe with McsLock can be tried")
+{
+    safe::Safe<int, safe::McsLock> safeValue(42);
+    {
+        auto value = safeValue.tryWriteLock();
+        REQUIRE(value);
+        ++*value;
+        std::thread([&]() {
+            CHECK_FALSE(safeValue.tryWriteLock());
+            CHECK_FALSE(safeValue.tryReadLock());
+        }).join();
+    }
+    auto value = safeValue.tryReadLock();
+    REQUIRE(value);
+    CHECK_EQ(*value, 43);
+}
+
+TEST_CASE("Safe objects with McsLock can be locked together with lockAll")
+{
+    safe::Safe<int, safe::McsLock> first(1);
+    safe::Safe<int, safe::McsLock> second(2);
+    {
+        auto accesses = safe::lockAll(first, second);
+        std::swap(*std::get<0>(accesses), *std::get<1>(accesses));
+    }
+    CHECK_EQ(*safe::ReadAccess<safe::Safe<int, safe::McsLock>>(first), 2);
+    CHECK_EQ(*safe::ReadAccess<safe::Safe<int, safe::McsLock>>(second), 1);
+}
@@ -0,0 +1,169 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/notifying_mutex.h"
+#include "safe/safe.h"
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("waitUntil returns at once if the predicate holds")
+{
+    safe::Safe<int, safe::NotifyingMutex> safeValue(42);
+    auto value = safeValue.waitUntil([](const int &value) { return value == 42; });
+    CHECK(value.lock.owns_lock());
+    ++*value;
+    value.lock.unlock();
+    CHECK_EQ(*safeValue.readLock(), 43);
+}
+
+TEST_CASE("waitUntil wakes up when a write makes the predicate hold")
+{
+    safe::Safe<int, safe::NotifyingMutex> safeValue(0);
+    std::atomic<bool> woken{false};
+    std::thread waiter([&]() {
+        auto value = safeValue.waitUntil([](const int &value) { return value == 2; });
+        CHECK_EQ(*value, 2);
+        woken.store(true);
+    });
+
+    *safeValue.writeLock() = 1;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK_FALSE(woken.load());
+
+    *safeValue.writeLock() = 2;
+    waiter.join();
+    CHECK(woken.load());
+}
+
+TEST_CASE("Only the waiters whose predicate holds are woken up")
+{
+    safe::Safe<int, safe::NotifyingMutex> safeValue(0);
+    std::atomic<int> evaluationsOnWaiterThreads{0};
+    std::vector<std::thread> waiters;
+    for (int expected = 1; expected <= 2; ++expected)
+    {
+        waiters.emplace_back([&, expected]() {
+            const auto waiterId = std::this_thread::get_id();
+            auto value = safeValue.waitUntil([&](const int &value) {
+                if (std::this_thread::get_id() == waiterId)
+                {
+                    ++evaluationsOnWaiterThreads;
+                }
+                return value == expected;
+            });
+            ++*value;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK_EQ(evaluationsOnWaiterThreads.load(), 2);
+
+    // Wakes up the first waiter, which wakes up the second one.
+    *safeValue.writeLock() = 1;
+    for (auto &waiter : waiters)
+    {
+        waiter.join();
+    }
+    CHECK_EQ(*safeValue.readLock(), 3);
+    // Each waiter evaluated its predicate once before waiting and once when woken up.
+    CHECK_EQ(evaluationsOnWaiterThreads.load(), 4);
+}
+
+TEST_CASE("waitFor returns an access that converts to false on timeout")
+{
+    safe::Safe<int, safe::NotifyingMutex> safeValue(0);
+    {
+        auto value = safeValue.waitFor([](const int &value) { return value == 1; }, std::chrono::milliseconds(10));
+        CHECK_FALSE(value);
+    }
+    CHECK(safeValue.mutex().try_lock());
+    safeValue.mutex().unlock();
+
+    std::thread writer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        *safeValue.writeLock() = 1;
+    });
+    auto value = safeValue.waitFor([](const int &value) { return value == 1; }, std::chrono::seconds(10));
+    REQUIRE(value);
+    CHECK_EQ(*value, 1);
+    value.lock.unlock();
+    writer.join();
+}
+
+TEST_CASE("Exceptions thrown by a predicate are rethrown on the waiting thread")
+{
+    safe::Safe<int, safe::NotifyingMutex> safeValue(0);
+    std::atomic<bool> threw{false};
+    std::thread waiter([&]() {
+        try
+        {
+            safeValue.waitUntil([](const int &value) {
+                if (value == 1)
+                {
+                    throw std::runtime_error("predicate failed");
+                }
+                return false;
+            });
+        }
+        catch (const std::runtime_error &)
+        {
+            threw.store(true);
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    // The predicate throws on this thread, when the mutex is unlocked.
+    *safeValue.writeLock() = 1;
+    waiter.join();
+    CHECK(threw.load());
+    // The waiter released the mutex when the exception left waitUntil().
+    CHECK(safeValue.mutex().try_lock());
+    safeValue.mutex().unlock();
+}
+
+TEST_CASE("Job queue consumers get all the jobs")
+{
+    constexpr int jobCount = 1000;
+    safe::Safe<std::deque<int>, safe::NotifyingMutex> safeJobs;
+    std::atomic<int> consumed{0};
+    std::vector<std::thread> consumers;
+    for (int consumer = 0; consumer < 4; ++consumer)
+    {
+        consumers.emplace_back([&]() {
+            while (true)
+            {
+                auto jobs = safeJobs.waitUntil([](const std::deque<int> &jobs) { return !jobs.empty(); });
+                const int job = jobs->front();
+                jobs->pop_front();
+                if (job < 0)
+                {
+                    return;
+                }
+                ++consumed;
+            }
+        });
+    }
+    for (int job = 0; job < jobCount; ++job)
+    {
+        safeJobs.writeLock()->push_back(job);
+    }
+    for (int consumer = 0; consumer < 4; ++consumer)
+    {
+        safeJobs.writeLock()->push_back(-1);
+    }
+    for (auto &consumer : consumers)
+    {
+        consumer.join();
+    }
+    CHECK_EQ(consumed.load(), jobCount);
+}
@@ -0,0 +1,114 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/pmr_safe.h"
+
+#include <doctest/doctest.h>
+
+#if __cplusplus >= 201703L
+#include <cstddef>
+#include <deque>
+#include <memory_resource>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+/// Memory resource that counts the bytes allocated from it and not deallocated yet.
+class CountingResource : public std::pmr::memory_resource
+{
+  public:
+    std::size_t allocated = 0;
+
+  private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        allocated += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment) override
+    {
+        allocated -= bytes;
+        std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+} // namespace
+
+TEST_CASE("PmrSafe constructs its container with an allocator that uses its resource")
+{
+    safe::PmrSafe<std::pmr::vector<int>> safeValues(3, 42);
+    auto values = safeValues.writeLock();
+    CHECK_EQ(values->size(), 3u);
+    CHECK_EQ(values->back(), 42);
+    CHECK_EQ(values->get_allocator().resource(), &safeValues.resource());
+}
+
+TEST_CASE("PmrSafe::reset gives the memory back to the upstream resource")
+{
+    CountingResource upstream;
+    std::pmr::memory_resource *const defaultResource = std::pmr::set_default_resource(&upstream);
+    {
+        safe::PmrSafe<std::pmr::unordered_map<int, int>> safeMap;
+        for (int key = 0; key < 1000; ++key)
+        {
+            safeMap.writeLock()->emplace(key, key);
+        }
+        CHECK_NE(upstream.allocated, 0u);
+
+        safeMap.reset();
+        CHECK_EQ(upstream.allocated, 0u);
+        CHECK(safeMap.readLock()->empty());
+        CHECK_EQ(safeMap.unsafe().get_allocator().resource(), &safeMap.resource());
+
+        safeMap.writeLock()->emplace(1, 1);
+        CHECK_NE(upstream.allocated, 0u);
+    }
+    CHECK_EQ(upstream.allocated, 0u);
+    std::pmr::set_default_resource(defaultResource);
+}
+
+TEST_CASE("PmrSafe works with a monotonic buffer resource")
+{
+    safe::PmrSafe<std::pmr::vector<long>, std::pmr::monotonic_buffer_resource> safeValues;
+    for (long value = 0; value < 100; ++value)
+    {
+        safeValues.writeLock()->push_back(value);
+    }
+    CHECK_EQ(safeValues.readLock()->at(99), 99);
+    safeValues.reset();
+    CHECK(safeValues.readLock()->empty());
+}
+
+TEST_CASE("PmrSafe constructs its resource from arguments")
+{
+    alignas(std::max_align_t) unsigned char buffer[1024];
+    // The upstream resource throws: all allocations must come from the buffer.
+    safe::PmrSafe<std::pmr::vector<int>, std::pmr::monotonic_buffer_resource> safeValues(
+        std::piecewise_construct, std::forward_as_tuple(buffer, sizeof(buffer), std::pmr::null_memory_resource()),
+        std::forward_as_tuple(10, 7));
+    auto values = safeValues.writeLock();
+    CHECK_EQ(values->size(), 10u);
+    const auto *const data = reinterpret_cast<const unsigned char *>(values->data());
+    CHECK(data >= buffer);
+    CHECK(data < buffer + sizeof(buffer));
+}
+
+TEST_CASE("PmrSafe::reset works with containers that allocate when empty")
+{
+    safe::PmrSafe<std::pmr::deque<int>> safeValues(100, 1);
+    safeValues.reset();
+    CHECK(safeValues.readLock()->empty());
+    safeValues.writeLock()->push_back(2);
+    CHECK_EQ(safeValues.readLock()->front(), 2);
+}
+#endif // __cplusplus >= 201703L
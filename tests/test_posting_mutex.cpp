@@ -0,0 +1,95 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/posting_mutex.h"
+#include "safe/safe.h"
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+TEST_CASE("Posted functions are called in order by the next thread that locks the mutex")
+{
+    safe::Safe<std::vector<int>, safe::PostingMutex> safeVector;
+    safeVector.post([](std::vector<int> &vector) { vector.push_back(1); });
+    safeVector.post([](std::vector<int> &vector) { vector.push_back(2); });
+    CHECK(safeVector.unsafe().empty());
+    CHECK(safeVector.mutex().pending());
+
+    const safe::ReadAccess<safe::Safe<std::vector<int>, safe::PostingMutex>> vector(safeVector);
+    CHECK_FALSE(safeVector.mutex().pending());
+    CHECK_EQ(*vector, std::vector<int>{1, 2});
+}
+
+TEST_CASE("Posted functions keep the order of each producer")
+{
+    constexpr int producerCount = 4;
+    constexpr int postCount = 1000;
+    safe::Safe<std::vector<std::pair<int, int>>, safe::PostingMutex> safePosts;
+
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < producerCount; ++producer)
+    {
+        producers.emplace_back([&, producer]() {
+            for (int index = 0; index < postCount; ++index)
+            {
+                safePosts.post([=](std::vector<std::pair<int, int>> &posts) { posts.emplace_back(producer, index); });
+                if (index % 100 == 0)
+                {
+                    // Consume concurrently with the producers.
+                    safe::WriteAccess<safe::Safe<std::vector<std::pair<int, int>>, safe::PostingMutex>> posts(
+                        safePosts);
+                }
+            }
+        });
+    }
+    for (auto &producer : producers)
+    {
+        producer.join();
+    }
+
+    const safe::ReadAccess<safe::Safe<std::vector<std::pair<int, int>>, safe::PostingMutex>> posts(safePosts);
+    REQUIRE_EQ(posts->size(), static_cast<std::size_t>(producerCount * postCount));
+    std::vector<int> nextIndex(producerCount, 0);
+    for (const auto &post : *posts)
+    {
+        CHECK_EQ(post.second, nextIndex[post.first]++);
+    }
+}
+
+TEST_CASE("Strand calls posted functions in the background and when destroyed")
+{
+    safe::Safe<int, safe::PostingMutex> safeValue(0);
+    {
+        safe::Strand<safe::Safe<int, safe::PostingMutex>> strand(safeValue);
+        safeValue.post([](int &value) { ++value; });
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (safeValue.mutex().pending() && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK_FALSE(safeValue.mutex().pending());
+        safeValue.post([](int &value) { ++value; });
+    }
+    CHECK_FALSE(safeValue.mutex().pending());
+    CHECK_EQ(safeValue.unsafe(), 2);
+}
+
+TEST_CASE("Pending functions are destroyed with the mutex")
+{
+    const auto counter = std::make_shared<int>(0);
+    {
+        safe::Safe<int, safe::PostingMutex> safeValue(0);
+        safeValue.post([counter](int &) {});
+        CHECK_EQ(counter.use_count(), 2);
+    }
+    CHECK_EQ(counter.use_count(), 1);
+}
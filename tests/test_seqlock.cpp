@@ -0,0 +1,142 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/seqlock.h"
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct Quote
+{
+    long bid;
+    long ask;
+};
+} // namespace
+
+TEST_CASE("SeqLock excludes writers")
+{
+    safe::SeqLock seqLock;
+    CHECK(seqLock.try_lock());
+    CHECK_FALSE(seqLock.try_lock());
+    seqLock.unlock();
+    CHECK(seqLock.try_lock());
+    seqLock.unlock();
+}
+
+TEST_CASE("SeqLock read validation fails if a writer took the lock")
+{
+    safe::SeqLock seqLock;
+    const auto sequence = seqLock.beginRead();
+    CHECK(seqLock.validateRead(sequence));
+    seqLock.lock();
+    seqLock.unlock();
+    CHECK_FALSE(seqLock.validateRead(sequence));
+}
+
+TEST_CASE("Safe with SeqLock write accesses store their copy back when destroyed")
+{
+    safe::Safe<Quote, safe::SeqLock> safeQuote(Quote{1, 2});
+    {
+        safe::WriteAccess<safe::Safe<Quote, safe::SeqLock>> quote(safeQuote);
+        quote->bid = 3;
+    }
+    const auto quote = safeQuote.readLock();
+    CHECK_EQ(quote->bid, 3);
+    CHECK_EQ(quote->ask, 2);
+    CHECK_EQ(safeQuote.load().bid, 3);
+}
+
+TEST_CASE("Safe with SeqLock accepts the default_construct_mutex tag")
+{
+    safe::Safe<int, safe::SeqLock> safeValue(42, safe::default_construct_mutex);
+    CHECK_EQ(safeValue.load(), 42);
+    safe::Safe<int, safe::SeqLock> defaultValue(safe::default_construct_mutex);
+    CHECK_EQ(defaultValue.load(), 0);
+}
+
+TEST_CASE("Safe with SeqLock write access locks the SeqLock")
+{
+    safe::Safe<int, safe::SeqLock> safeValue(0);
+    {
+        auto value = safeValue.writeLock<std::unique_lock>();
+        CHECK_FALSE(safeValue.mutex().try_lock());
+    }
+    CHECK(safeValue.mutex().try_lock());
+    safeValue.mutex().unlock();
+}
+
+TEST_CASE("Safe with SeqLock stores values that are not a whole number of words")
+{
+    struct Bytes
+    {
+        char values[11];
+    };
+    safe::Safe<Bytes, safe::SeqLock> safeBytes(Bytes{{'s', 'e', 'q', 'l', 'o', 'c', 'k', 0, 1, 2, 3}});
+    safeBytes.writeLock()->values[10] = 42;
+    const auto bytes = safeBytes.readLock();
+    CHECK_EQ(bytes->values[0], 's');
+    CHECK_EQ(bytes->values[9], 2);
+    CHECK_EQ(bytes->values[10], 42);
+}
+
+TEST_CASE("Safe with SeqLock readers never see torn writes")
+{
+    safe::Safe<Quote, safe::SeqLock> safeQuote(Quote{0, 0});
+    std::atomic<bool> stop{false};
+    std::atomic<bool> torn{false};
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; ++i)
+    {
+        readers.emplace_back([&]() {
+            while (!stop.load())
+            {
+                const auto quote = safeQuote.readLock();
+                if (quote->bid != quote->ask)
+                {
+                    torn.store(true);
+                }
+            }
+        });
+    }
+    for (long i = 1; i <= 10000; ++i)
+    {
+        auto quote = safeQuote.writeLock<std::unique_lock>();
+        quote->bid = i;
+        std::this_thread::yield();
+        quote->ask = i;
+    }
+    stop.store(true);
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+
+    CHECK_FALSE(torn.load());
+    CHECK_EQ(safeQuote.load().ask, 10000);
+}
+
+TEST_CASE("tryReadLock gives up while a writer holds the SeqLock")
+{
+    safe::Safe<Quote, safe::SeqLock> safeQuote(Quote{1, 2});
+    {
+        auto quote = safeQuote.writeLock<std::unique_lock>();
+        quote->bid = 3;
+        CHECK_FALSE(safeQuote.tryReadLock());
+        CHECK_FALSE(safeQuote.tryReadLock(std::chrono::milliseconds(1)));
+    }
+    const auto quote = safeQuote.tryReadLock();
+    REQUIRE(quote);
+    CHECK_EQ(quote->bid, 3);
+}
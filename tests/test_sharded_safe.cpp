@@ -0,0 +1,112 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/sharded_safe.h"
+
+#include <doctest/doctest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+using ShardedMap = safe::ShardedSafe<std::unordered_map<int, std::string>, 8>;
+
+struct ThrowingHash
+{
+    std::size_t operator()(int) const
+    {
+        throw std::runtime_error("hash failed");
+    }
+};
+} // namespace
+
+TEST_CASE("ShardedSafe shards are on different cache lines")
+{
+    ShardedMap shardedMap;
+    for (std::size_t index = 1; index < ShardedMap::shardCount; ++index)
+    {
+        const auto *previous = reinterpret_cast<const char *>(&shardedMap.shard(index - 1));
+        const auto *current = reinterpret_cast<const char *>(&shardedMap.shard(index));
+        CHECK_GE(static_cast<std::size_t>(current - previous), safe::cacheLineSize);
+        CHECK_EQ(reinterpret_cast<std::uintptr_t>(current) % safe::cacheLineSize, 0u);
+    }
+}
+
+TEST_CASE("ShardedSafe locks the shard of the key")
+{
+    ShardedMap shardedMap;
+    {
+        auto map = shardedMap.writeLock<std::unique_lock>(42);
+        (*map)[42] = "forty-two";
+        CHECK_FALSE(shardedMap.shardFor(42).mutex().try_lock());
+    }
+    CHECK_EQ(shardedMap.readLock<std::unique_lock>(42)->at(42), "forty-two");
+    CHECK_EQ(shardedMap.shardFor(42).unsafe().count(42), 1u);
+    CHECK_EQ(&shardedMap.shardFor(42), &shardedMap.shard(ShardedMap::shardIndex(42)));
+}
+
+TEST_CASE("ShardedSafe lets exceptions thrown by the hash function through")
+{
+    safe::ShardedSafe<std::unordered_map<int, std::string>, 8, std::mutex, ThrowingHash> shardedMap;
+    CHECK_THROWS_AS(shardedMap.shardFor(42), std::runtime_error);
+    CHECK_THROWS_AS(shardedMap.writeLock(42), std::runtime_error);
+}
+
+TEST_CASE("ShardedSafe spreads consecutive keys over all shards")
+{
+    std::size_t counts[ShardedMap::shardCount] = {};
+    for (int key = 0; key < 8000; ++key)
+    {
+        ++counts[ShardedMap::shardIndex(key)];
+    }
+    for (const auto count : counts)
+    {
+        CHECK_GT(count, 800u);
+        CHECK_LT(count, 1200u);
+    }
+}
+
+TEST_CASE("ShardedSafe visits all shards")
+{
+    ShardedMap shardedMap;
+    for (int key = 0; key < 100; ++key)
+    {
+        (*shardedMap.writeLock<std::unique_lock>(key))[key] = std::to_string(key);
+    }
+
+    std::size_t sequentialCount = 0;
+    shardedMap.forEachShard([&](std::unordered_map<int, std::string> &map) { sequentialCount += map.size(); });
+    CHECK_EQ(sequentialCount, 100u);
+
+    std::size_t consistentCount = 0;
+    const ShardedMap &constShardedMap = shardedMap;
+    constShardedMap.visitAll([&](const std::unordered_map<int, std::string> &map) {
+        consistentCount += map.size();
+        CHECK_FALSE(shardedMap.shard(0).mutex().try_lock());
+    });
+    CHECK_EQ(consistentCount, 100u);
+}
+
+TEST_CASE("ShardedSafe visits all shards of a large ShardedSafe")
+{
+    safe::ShardedSafe<std::unordered_map<int, int>, 1024> shardedMap;
+    for (int key = 0; key < 4096; ++key)
+    {
+        (*shardedMap.writeLock<std::unique_lock>(key))[key] = key;
+    }
+
+    std::size_t count = 0;
+    shardedMap.visitAll([&](std::unordered_map<int, int> &map) { count += map.size(); });
+    CHECK_EQ(count, 4096u);
+    CHECK(shardedMap.shard(1023).mutex().try_lock());
+    shardedMap.shard(1023).mutex().unlock();
+}
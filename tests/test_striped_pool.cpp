@@ -0,0 +1,107 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/striped_pool.h"
+
+#include <doctest/doctest.h>
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+TEST_CASE("StripedPool gives the same mutex for the same address or key")
+{
+    safe::StripedPool<16> pool;
+    int value = 0;
+    CHECK_EQ(&pool.mutexFor(&value), &pool.mutexFor(&value));
+    CHECK_EQ(&pool.mutexForKey(std::string("key")), &pool.mutexForKey(std::string("key")));
+}
+
+TEST_CASE("StripedPool spreads neighbouring values over the stripes")
+{
+    safe::StripedPool<16> pool;
+    int values[256];
+    std::set<const std::mutex *> mutexes;
+    for (const int &value : values)
+    {
+        mutexes.insert(&pool.mutexFor(&value));
+    }
+    CHECK_EQ(mutexes.size(), 16u);
+}
+
+TEST_CASE("StripedPool handles lock the mutex of their stripe")
+{
+    safe::StripedPool<4> pool;
+    int value = 42;
+    safe::StripedPool<4>::Handle<int> safeValue(value, pool.mutexFor(&value));
+    {
+        safe::WriteAccess<safe::StripedPool<4>::Handle<int>> access(safeValue);
+        ++*access;
+        std::thread([&]() { CHECK_FALSE(pool.mutexFor(&value).try_lock()); }).join();
+    }
+    CHECK_EQ(value, 43);
+}
+
+TEST_CASE("StripedPool locks two handles that share a stripe together")
+{
+    safe::StripedPool<1> pool;
+    int first = 1;
+    int second = 2;
+    safe::StripedPool<1>::Handle<int> safeFirst(first, pool.mutexFor(&first));
+    safe::StripedPool<1>::Handle<int> safeSecond(second, pool.mutexFor(&second));
+    {
+        auto access = pool.lockBoth(safeFirst, safeSecond);
+        access.first += 10;
+        access.second += 20;
+        std::thread([&]() { CHECK_FALSE(pool.mutexFor(&first).try_lock()); }).join();
+    }
+    CHECK_EQ(first, 11);
+    CHECK_EQ(second, 22);
+    // The stripe was unlocked once, and only once.
+    CHECK(pool.mutexFor(&first).try_lock());
+    pool.mutexFor(&first).unlock();
+}
+
+TEST_CASE("StripedPool locks two handles on different stripes together")
+{
+    safe::StripedPool<16> pool;
+    int values[2] = {1, 2};
+    int key = 0;
+    while (&pool.mutexForKey(key) == &pool.mutexForKey(1000))
+    {
+        ++key;
+    }
+    safe::StripedPool<16>::Handle<int> safeFirst(values[0], pool.mutexForKey(key));
+    safe::StripedPool<16>::Handle<int> safeSecond(values[1], pool.mutexForKey(1000));
+    {
+        auto access = pool.lockBoth(safeFirst, safeSecond);
+        std::swap(access.first, access.second);
+        std::thread([&]() {
+            CHECK_FALSE(pool.mutexForKey(key).try_lock());
+            CHECK_FALSE(pool.mutexForKey(1000).try_lock());
+        }).join();
+    }
+    CHECK_EQ(values[0], 2);
+    CHECK_EQ(values[1], 1);
+}
+
+#if __cplusplus >= 201703L
+TEST_CASE("StripedPool binds values by address or by key")
+{
+    safe::StripedPool<8> pool;
+    int value = 42;
+    auto safeValue = pool.bind(value);
+    CHECK_EQ(&safeValue.mutex(), &pool.mutexFor(&value));
+    auto safeKeyedValue = pool.bind(value, 7);
+    CHECK_EQ(&safeKeyedValue.mutex(), &pool.mutexForKey(7));
+    *safeKeyedValue.writeLock() = 43;
+    CHECK_EQ(*safeValue.readLock(), 43);
+}
+#endif // __cplusplus >= 201703L
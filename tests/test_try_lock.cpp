@@ -0,0 +1,108 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/distributed_shared_mutex.h"
+#include "safe/safe.h"
+
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace
+{
+/// Counts the calls to try_lock.
+struct CountingMutex
+{
+    void lock()
+    {
+        mutex.lock();
+    }
+    bool try_lock()
+    {
+        ++tryCount;
+        return mutex.try_lock();
+    }
+    void unlock()
+    {
+        mutex.unlock();
+    }
+
+    std::mutex mutex;
+    unsigned tryCount = 0;
+};
+} // namespace
+
+TEST_CASE("tryWriteLock owns the mutex if it is free")
+{
+    safe::Safe<int> safeValue(42);
+    auto value = safeValue.tryWriteLock();
+    static_assert(std::is_same<decltype(value.lock), std::unique_lock<std::mutex>>::value,
+                  "std::lock_guard cannot try to lock, std::unique_lock should be used instead.");
+    REQUIRE(value);
+    *value = 43;
+    CHECK_EQ(safeValue.unsafe(), 43);
+}
+
+TEST_CASE("tryReadLock and tryWriteLock do not own the mutex if it is locked")
+{
+    safe::Safe<int> safeValue(42);
+    safeValue.mutex().lock();
+    std::thread([&]() {
+        CHECK_FALSE(safeValue.tryReadLock());
+        CHECK_FALSE(safeValue.tryWriteLock());
+    }).join();
+    safeValue.mutex().unlock();
+    const auto value = safeValue.tryReadLock();
+    REQUIRE(value);
+    static_assert(std::is_const<std::remove_reference<decltype(*value)>::type>::value,
+                  "TryReadAccess should give const access.");
+    CHECK_EQ(*value, 42);
+}
+
+TEST_CASE("tryWriteLock with a Backoff object tries the mutex a bounded number of times")
+{
+    safe::Safe<int, CountingMutex> safeValue(42);
+    safeValue.mutex().lock();
+    CHECK_FALSE(safeValue.tryWriteLock(safe::Backoff(5)));
+    CHECK_EQ(safeValue.mutex().tryCount, 5u);
+    safeValue.mutex().unlock();
+
+    CHECK(safeValue.tryWriteLock(safe::Backoff(5)));
+    CHECK_EQ(safeValue.mutex().tryCount, 6u);
+}
+
+TEST_CASE("tryWriteLock with a timeout waits for a timed mutex")
+{
+    safe::Safe<int, std::timed_mutex> safeValue(42);
+    safeValue.mutex().lock();
+    std::thread([&]() {
+        const auto start = std::chrono::steady_clock::now();
+        CHECK_FALSE(safeValue.tryWriteLock(std::chrono::milliseconds(10)));
+        CHECK_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(10));
+        CHECK_FALSE(safeValue.tryReadLock(std::chrono::steady_clock::now() + std::chrono::milliseconds(1)));
+    }).join();
+    safeValue.mutex().unlock();
+    CHECK(safeValue.tryWriteLock(std::chrono::milliseconds(10)));
+}
+
+#if __cplusplus >= 201402L
+TEST_CASE("tryReadLock uses the default read-only lock type if it can try to lock")
+{
+    safe::Safe<int, safe::DistributedSharedMutex> safeValue(42);
+    const auto value = safeValue.tryReadLock();
+    static_assert(std::is_same<decltype(value.lock), std::shared_lock<safe::DistributedSharedMutex>>::value,
+                  "The default read-only lock type should be used.");
+    REQUIRE(value);
+    std::thread([&]() {
+        CHECK(safeValue.tryReadLock());
+        CHECK_FALSE(safeValue.tryWriteLock());
+    }).join();
+}
+#endif // __cplusplus >= 201402L
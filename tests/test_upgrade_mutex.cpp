@@ -0,0 +1,88 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/safe.h"
+#include "safe/upgrade_mutex.h"
+
+#include <doctest/doctest.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+TEST_CASE("UpgradeLock is read only")
+{
+    struct UpgradeableMutex
+    {
+        void lock_upgrade()
+        {
+        }
+        void unlock_upgrade()
+        {
+        }
+    };
+    CHECK(safe::AccessTraits<safe::UpgradeLock<UpgradeableMutex>>::IsReadOnly);
+}
+
+#if __cplusplus >= 201402L
+#include <shared_mutex>
+
+TEST_CASE("UpgradeAccess gives const access to the value")
+{
+    safe::Safe<int, safe::UpgradeMutex> safeValue(42);
+    auto value = safeValue.upgradeLock();
+    CHECK(std::is_const<std::remove_reference<decltype(*value)>::type>::value);
+    CHECK_EQ(*value, 42);
+}
+
+TEST_CASE("UpgradeAccess coexists with readers and excludes writers and upgraders")
+{
+    safe::Safe<int, safe::UpgradeMutex> safeValue(42);
+    auto value = safeValue.upgradeLock();
+
+    CHECK(safeValue.readLock<std::shared_lock>(std::try_to_lock).lock.owns_lock());
+    CHECK_FALSE(safeValue.upgradeLock(std::try_to_lock).lock.owns_lock());
+    CHECK_FALSE(safeValue.writeLock<std::unique_lock>(std::try_to_lock).lock.owns_lock());
+}
+
+TEST_CASE("UpgradeAccess upgrades to a WriteAccess")
+{
+    safe::Safe<int, safe::UpgradeMutex> safeValue(42);
+    {
+        auto upgradeable = safeValue.upgradeLock();
+        auto value = upgradeable.upgrade();
+        CHECK_FALSE(upgradeable.lock.owns_lock());
+        CHECK(value.lock.owns_lock());
+
+        *value = 43;
+        CHECK_FALSE(safeValue.readLock<std::shared_lock>(std::try_to_lock).lock.owns_lock());
+        CHECK_FALSE(safeValue.upgradeLock(std::try_to_lock).lock.owns_lock());
+    }
+    CHECK_EQ(*safeValue.readLock<std::shared_lock>(), 43);
+    CHECK(safeValue.writeLock<std::unique_lock>(std::try_to_lock).lock.owns_lock());
+}
+
+TEST_CASE("UpgradeAccess fills a cache without releasing the lock")
+{
+    safe::Safe<std::map<int, std::string>, safe::UpgradeMutex> safeCache;
+    const auto find = [&](int key) {
+        auto cache = safeCache.upgradeLock();
+        const auto found = cache->find(key);
+        if (found != cache->end())
+        {
+            return found->second;
+        }
+        auto writableCache = cache.upgrade();
+        return (*writableCache)[key] = std::to_string(key);
+    };
+
+    CHECK_EQ(find(1), "1");
+    CHECK_EQ(find(1), "1");
+    CHECK_EQ(safeCache.readLock<std::shared_lock>()->size(), 1u);
+}
+#endif // __cplusplus >= 201402L
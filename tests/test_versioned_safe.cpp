@@ -0,0 +1,80 @@
+// Copyright (c) 2023 Louis-Charles Caron
+
+// This file is part of the safe library (https://github.com/LouisCharlesC/safe).
+
+// Use of this source code is governed by an MIT-style license that can be
+// found in the LICENSE file or at https://opensource.org/licenses/MIT.
+
+#include "safe/versioned_safe.h"
+
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+TEST_CASE("VersionedSafe write accesses increment the version")
+{
+    safe::VersionedSafe<int> safeValue(42);
+    CHECK_EQ(safeValue.version(), 0u);
+    *safeValue.writeLock() = 43;
+    CHECK_EQ(safeValue.version(), 1u);
+    {
+        safe::WriteAccess<safe::VersionedSafe<int>> value(safeValue);
+        // Incremented when the mutex is unlocked.
+        CHECK_EQ(safeValue.version(), 1u);
+    }
+    CHECK_EQ(safeValue.version(), 2u);
+    CHECK_EQ(*safeValue.readLock(), 43);
+    CHECK_EQ(safeValue.version(), 2u);
+}
+
+TEST_CASE("VersionedSafe::readIfChanged locks the mutex only if the version changed")
+{
+    safe::VersionedSafe<int> safeValue(42);
+    std::uint64_t lastVersion = 0;
+    CHECK_FALSE(safeValue.readIfChanged(lastVersion));
+
+    *safeValue.writeLock() = 43;
+    {
+        auto value = safeValue.readIfChanged(lastVersion);
+        REQUIRE(value);
+        CHECK_EQ(*value, 43);
+        CHECK_EQ(lastVersion, 1u);
+    }
+    CHECK_FALSE(safeValue.readIfChanged(lastVersion));
+}
+
+TEST_CASE("VersionedSafe::update commits a copy if the version did not change")
+{
+    safe::VersionedSafe<std::vector<int>> safeValues(3, 1);
+    CHECK(safeValues.update([](std::vector<int> &values) { values.push_back(2); }));
+    CHECK_EQ(safeValues.unsafe(), std::vector<int>{1, 1, 1, 2});
+    CHECK_EQ(safeValues.version(), 1u);
+}
+
+TEST_CASE("VersionedSafe::update starts over if another write happened, then falls back to locking")
+{
+    safe::VersionedSafe<int> safeValue(0);
+    unsigned calls = 0;
+    // Each optimistic attempt is spoiled by a concurrent write.
+    const bool optimistic = safeValue.update(
+        [&](int &value) {
+            if (++calls <= 2)
+            {
+                std::thread([&]() { *safeValue.writeLock() += 100; }).join();
+            }
+            else
+            {
+                // The fallback holds the mutex.
+                std::thread([&]() { CHECK_FALSE(safeValue.mutex().try_lock()); }).join();
+            }
+            ++value;
+        },
+        2);
+    CHECK_FALSE(optimistic);
+    CHECK_EQ(calls, 3u);
+    CHECK_EQ(safeValue.unsafe(), 201);
+    CHECK_EQ(safeValue.version(), 3u);
+}